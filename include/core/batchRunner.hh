@@ -0,0 +1,163 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+
+#include <core/bisectionRunRecord.hh>
+#include <core/engineRegistry.hh>
+#include <core/logLevel.hh>
+#include <util/datasetCache.hh>
+#include <util/treeCost.hh>
+
+// One run of a batch, keyed like the result.csv row it produces.
+struct BatchJob_t {
+    std::string datasetName;
+    std::string algorithm;
+    int maxIterations = 20;
+    int maxDepth = 0;
+};
+
+// Every combination of the given values, in the nesting order scripts/batch_run.py
+// used (algorithm outermost, dataset innermost).
+inline std::vector<BatchJob_t> expandJobGrid (
+    const std::vector<std::string>& algorithms, const std::vector<int>& depths,
+    const std::vector<int>& iterations, const std::vector<std::string>& datasets
+) {
+    std::vector<BatchJob_t> jobs;
+    for (const auto& algorithm : algorithms)
+        for (int depth : depths)
+            for (int iters : iterations)
+                for (const auto& dataset : datasets)
+                    jobs.push_back({ dataset, algorithm, iters, depth });
+    return jobs;
+}
+
+// One job per line as "dataset,algorithm,max-iterations,max-depth", the column order
+// of result.csv. Blank lines and lines starting with '#' are skipped.
+inline std::vector<BatchJob_t> readJobFile (const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open job file: " + path);
+    }
+
+    std::vector<BatchJob_t> jobs;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::stringstream ss(line);
+        std::string dataset, algorithm, iters, depth;
+        if (!std::getline(ss, dataset, ',') || !std::getline(ss, algorithm, ',')
+            || !std::getline(ss, iters, ',') || !std::getline(ss, depth, ',')) {
+            throw std::runtime_error("Invalid job line in " + path + ": " + line);
+        }
+        jobs.push_back({ dataset, algorithm, std::stoi(iters), std::stoi(depth) });
+    }
+    return jobs;
+}
+
+using DatasetLoader_t = std::function<pisa::datasetBundle(const std::string&)>;
+
+// Runs every job in this process. Each distinct dataset is loaded once into an
+// EngineInput_t, so its forward indexes and other derived representations are built
+// once and shared by all jobs on it. Jobs run concurrently as tasks of one arena of
+// base.threads threads and append their result.csv / metrics.out rows under a lock as
+// they finish, so rows follow completion order and line i of metrics.out belongs to
+// row i of result.csv. A failing job is reported and skipped; returns the failure count.
+inline size_t runBatch (
+    const std::vector<BatchJob_t>& jobs, const DatasetLoader_t& load,
+    const EngineOptions_t& base, const std::string& outputDirectory
+) {
+    // resolve every engine before spending time on loading
+    std::vector<const EngineEntry_t*> engines;
+    for (const auto& job : jobs)
+        engines.push_back(&findEngine(job.algorithm));
+
+    std::map<std::string, std::unique_ptr<EngineInput_t>> inputs;
+    for (const auto& job : jobs) {
+        auto& input = inputs[job.datasetName];
+        if (!input) {
+            input = std::make_unique<EngineInput_t>(load(job.datasetName));
+            log(LogLevel::Info) << "Loaded dataset with " << input->numVertices() << " vertices and "
+                        << input->demand().numEntries() << " non-zero demands." << std::endl;
+        }
+    }
+
+    std::filesystem::create_directories(outputDirectory);
+
+    std::mutex outputMutex;
+    std::atomic<size_t> failed{0};
+    size_t finished = 0;
+
+    auto runJob = [&](size_t idx) {
+        const BatchJob_t& job = jobs[idx];
+        const EngineEntry_t& engine = *engines[idx];
+        const EngineInput_t& input = *inputs.at(job.datasetName);
+
+        RunConfig config;
+        config.algorithm = job.algorithm;
+        config.datasetName = job.datasetName;
+        config.maxIterations = job.maxIterations;
+        config.maxDepth = job.maxDepth;
+        config.outputDirectory = outputDirectory;
+        BisectionRunRecord record(config);
+
+        EngineOptions_t options = base;
+        options.maxDepth = job.maxDepth;
+        options.maxIterations = job.maxIterations;
+
+        try {
+            const auto beginTime = std::chrono::steady_clock::now();
+            std::vector<uint32_t> vertices = runEngineFromIdentity(engine, input, options, record);
+            double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - beginTime).count();
+
+            double totalCost = pisa::balancedTreeCost(vertices, input.demand());
+            record.recordTotalCost(totalCost);
+
+            std::lock_guard<std::mutex> lock(outputMutex);
+            record.appendToCsv();
+            record.appendMetrics();
+            log(LogLevel::Info) << "[" << ++finished << "/" << jobs.size() << "] " << engine.label
+                        << " on " << job.datasetName << " (depth " << job.maxDepth
+                        << ", iterations " << job.maxIterations << "): cost " << totalCost
+                        << " in " << secs << "s" << std::endl;
+            log(LogLevel::Debug) << "Average passes per level: " << record.averageIterationCount()
+                        << ", average swapped pairs per pass: " << record.averageSwappedPairs() << std::endl;
+        } catch (const std::exception& err) {
+            failed++;
+            std::lock_guard<std::mutex> lock(outputMutex);
+            ++finished;
+            log(LogLevel::Error) << engine.label << " on " << job.datasetName << " failed: "
+                        << err.what() << std::endl;
+        }
+    };
+
+    tbb::task_arena arena(base.threads > 0 ? base.threads : tbb::task_arena::automatic);
+    arena.execute([&] {
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, jobs.size(), 1), [&](const tbb::blocked_range<size_t>& range) {
+            for (size_t idx = range.begin(); idx != range.end(); ++idx) {
+                // a thread waiting inside one job must not pick up another whole job:
+                // that would stall the first until the second finishes, and could
+                // re-enter a representation the first job is still building
+                tbb::this_task_arena::isolate([&] { runJob(idx); });
+            }
+        });
+    });
+
+    return failed;
+}
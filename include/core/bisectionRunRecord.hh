@@ -1,6 +1,9 @@
 #pragma once
 
 #include <core/runConfig.hh>
+#include <fstream>
+#include <iostream>
+#include <numeric>
 #include <vector>
 #include <string>
 
@@ -29,6 +32,13 @@ public:
         mLogACost_ = cost;
     }
 
+    // appends another record's samples (e.g. a per-thread sub-record); config and costs are kept
+    void merge(const BisectionRunRecord& other) {
+        costGainSamples_.insert(costGainSamples_.end(), other.costGainSamples_.begin(), other.costGainSamples_.end());
+        swappedPairsSamples_.insert(swappedPairsSamples_.end(), other.swappedPairsSamples_.begin(), other.swappedPairsSamples_.end());
+        iterationCountSamples_.insert(iterationCountSamples_.end(), other.iterationCountSamples_.begin(), other.iterationCountSamples_.end());
+    }
+
     // --- aggregate queries ---
     double averageCostGain() const {
         if (costGainSamples_.empty()) return 0.0;
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <tbb/task_group.h>
+
+#include <core/util.hh>
+#include <core/bisectionRunRecord.hh>
+
+// Recurses into both halves of a bisection level. With parallelize set the halves
+// run as TBB tasks, each with its own sub-record, and the sub-records are merged
+// left then right once both finish; samples end up in the same order as a serial run.
+template<typename Recurse>
+void recurseOnHalves (
+    const VectorLimits_t& leftLimits, const VectorLimits_t& rightLimits,
+    bool parallelize, BisectionRunRecord& record, Recurse recurse
+) {
+    if (!parallelize) {
+        recurse(leftLimits, record);
+        recurse(rightLimits, record);
+        return;
+    }
+
+    BisectionRunRecord leftRecord(record.config());
+    BisectionRunRecord rightRecord(record.config());
+    tbb::task_group tasks;
+    tasks.run([&] { recurse(leftLimits, leftRecord); });
+    tasks.run_and_wait([&] { recurse(rightLimits, rightRecord); });
+
+    record.merge(leftRecord);
+    record.merge(rightRecord);
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <tbb/task_arena.h>
+
+#include <core/bisectionRunRecord.hh>
+#include <core/util.hh>
+#include <graphbissection.hh>
+#include <mloggapbissection.hh>
+#include <onehopbissection.hh>
+#include <recursiveGraphBisection.hh>
+#include <util/datasetCache.hh>
+#include <util/forwardIndexFactory.hh>
+#include <util/sparseDemand.hh>
+
+// A loaded dataset plus the engine-specific representations derived from it. Each
+// representation is built on first use (thread-safe) and then shared by every engine
+// run against the same input; forward indexes that came with the dataset (e.g. from a
+// mapped cache) are used as they are.
+class EngineInput_t {
+public:
+    explicit EngineInput_t(pisa::sparseDemand demand) : demand_(std::move(demand)) {}
+
+    explicit EngineInput_t(pisa::datasetBundle dataset) : demand_(std::move(dataset.demand)) {
+        if (dataset.mlogaIndex) {
+            std::call_once(mlogaOnce_, [&] { mlogaIndex_ = std::move(*dataset.mlogaIndex); });
+        }
+        if (dataset.logGapIndex) {
+            std::call_once(logGapOnce_, [&] { logGapIndex_ = std::move(*dataset.logGapIndex); });
+        }
+    }
+
+    EngineInput_t(const EngineInput_t&) = delete;
+    EngineInput_t& operator=(const EngineInput_t&) = delete;
+
+    const pisa::sparseDemand& demand() const { return demand_; }
+    uint32_t numVertices() const { return demand_.numVertices(); }
+
+    const pisa::forwardIndex& mlogaIndex() const {
+        std::call_once(mlogaOnce_, [this] { mlogaIndex_ = pisa::createMlogaForwardIndex(demand_); });
+        return mlogaIndex_;
+    }
+
+    const pisa::forwardIndex& logGapIndex() const {
+        std::call_once(logGapOnce_, [this] { logGapIndex_ = pisa::createLogGapForwardIndex(demand_); });
+        return logGapIndex_;
+    }
+
+    // O(n^2) memory; only the dense legacy engines (basic, onehop) ask for it
+    const std::vector<std::vector<double>>& denseDemand() const {
+        std::call_once(denseOnce_, [this] { denseDemand_ = demand_.toDense(); });
+        return denseDemand_;
+    }
+
+    const mloggapa::Graph_t& bipartiteGraph() const {
+        std::call_once(bipartiteOnce_, [this] {
+            bipartiteGraph_ = std::make_unique<mloggapa::Graph_t>(mloggapa::bipartiteGraph(demand_));
+        });
+        return *bipartiteGraph_;
+    }
+
+private:
+    pisa::sparseDemand demand_;
+    mutable std::once_flag mlogaOnce_, logGapOnce_, denseOnce_, bipartiteOnce_;
+    mutable pisa::forwardIndex mlogaIndex_, logGapIndex_;
+    mutable std::vector<std::vector<double>> denseDemand_;
+    mutable std::unique_ptr<mloggapa::Graph_t> bipartiteGraph_;
+};
+
+struct EngineOptions_t {
+    uint32_t maxDepth = 0;
+    int maxIterations = 20;
+    int threads = 0;                    // size of the task arena the engine runs in; 0 = all cores
+    bool parallelize = true;            // legacy engines: recurse into both halves as TBB tasks
+    pisa::bisectionConfig bisection;    // pisa engines only; record is filled in by the engine
+};
+
+// Reorders `vertices` (a permutation of the input's vertex IDs) in place and reports
+// its per-level samples to `record`.
+using Engine_t = std::function<void(
+    const EngineInput_t&, std::vector<uint32_t>&, const EngineOptions_t&, BisectionRunRecord&
+)>;
+
+struct EngineEntry_t {
+    std::string name, label;
+    Engine_t run;
+};
+
+inline Engine_t pisaEngine(const pisa::forwardIndex& (EngineInput_t::*index)() const) {
+    return [index](
+        const EngineInput_t& input, std::vector<uint32_t>& vertices,
+        const EngineOptions_t& options, BisectionRunRecord& record
+    ) {
+        std::vector<double> gains(input.numVertices(), 0.0);
+        pisa::verticeRange range(vertices.begin(), vertices.end(), std::cref((input.*index)()), std::ref(gains));
+        pisa::bisectionConfig config = options.bisection;
+        config.record = &record;
+        size_t cacheDepth = options.maxDepth > 6 ? options.maxDepth - 6 : 0;
+        pisa::recursiveGraphBisection(range, options.maxDepth, options.maxIterations, cacheDepth, config);
+    };
+}
+
+template<typename Reorder>
+Engine_t denseEngine(Reorder reorderFn) {
+    return [reorderFn](
+        const EngineInput_t& input, std::vector<uint32_t>& vertices,
+        const EngineOptions_t& options, BisectionRunRecord& record
+    ) {
+        reorderFn(
+            input.denseDemand(), vertices, VectorLimits_t{0, input.numVertices()},
+            options.maxDepth, options.parallelize, record, options.maxIterations
+        );
+    };
+}
+
+inline const std::vector<EngineEntry_t>& engineRegistry() {
+    static const std::vector<EngineEntry_t> engines = {
+        { "noop", "No Reordering", [](auto&&...) {} },
+        { "mloga", "BP over MLOGA forward index", pisaEngine(&EngineInput_t::mlogaIndex) },
+        { "loggap", "BP over LogGap forward index", pisaEngine(&EngineInput_t::logGapIndex) },
+        { "basic", "Basic Reordering", denseEngine(basic::graphReordering) },
+        { "onehop", "OneHop Reordering", denseEngine(onehop::graphReordering) },
+        { "mloggap", "MLogGapA Reordering", [](
+            const EngineInput_t& input, std::vector<uint32_t>& vertices,
+            const EngineOptions_t& options, BisectionRunRecord& record
+        ) {
+            mloggapa::bipartiteGraphReordering(
+                input.bipartiteGraph(), vertices, VectorLimits_t{0, input.numVertices()},
+                options.maxDepth, options.parallelize, record, options.maxIterations
+            );
+        } },
+    };
+    return engines;
+}
+
+inline const EngineEntry_t& findEngine(const std::string& name) {
+    const auto& engines = engineRegistry();
+    auto it = std::find_if(engines.begin(), engines.end(), [&](const EngineEntry_t& e) { return e.name == name; });
+    if (it == engines.end()) {
+        std::string available;
+        for (const auto& engine : engines) {
+            available += (available.empty() ? "" : ", ") + engine.name;
+        }
+        throw std::runtime_error("Unknown algorithm: " + name + " (available: " + available + ")");
+    }
+    return *it;
+}
+
+// Runs `engine` from the identity ordering on the calling thread's arena and returns the
+// resulting ordering; runBatch calls it from jobs that already run inside one.
+inline std::vector<uint32_t> runEngineFromIdentity(
+    const EngineEntry_t& engine, const EngineInput_t& input,
+    const EngineOptions_t& options, BisectionRunRecord& record
+) {
+    std::vector<uint32_t> vertices(input.numVertices());
+    std::iota(vertices.begin(), vertices.end(), 0);
+    engine.run(input, vertices, options, record);
+    return vertices;
+}
+
+// runEngineFromIdentity inside a task arena of options.threads threads.
+inline std::vector<uint32_t> runEngine(
+    const EngineEntry_t& engine, const EngineInput_t& input,
+    const EngineOptions_t& options, BisectionRunRecord& record
+) {
+    tbb::task_arena arena(options.threads > 0 ? options.threads : tbb::task_arena::automatic);
+    return arena.execute([&] { return runEngineFromIdentity(engine, input, options, record); });
+}
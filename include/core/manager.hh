@@ -1,9 +1,13 @@
 #pragma once
 
+#include <chrono>
+
 #include <core/util.hh>
 #include <core/bisectionRunRecord.hh>
 #include <treebuilders/optbst.hh>
 #include <treebuilders/greedy.hh>
+#include <util/sparseDemand.hh>
+#include <util/treeCost.hh>
 
 struct Response_t {
     double cost;
@@ -13,30 +17,20 @@ struct Response_t {
 double testGraphOrder (
     const std::vector<uint32_t>& vertices, const std::vector<std::vector<double>>& demandMatrix
 ) {
-    uint32_t nVertices = vertices.size();
-
-    std::vector<std::vector<uint32_t>> tree(nVertices, std::vector<uint32_t>());
-    buildBalancedBinaryTree(vertices, tree, {0, nVertices}, -1);
-
-    std::vector<std::vector<double>> reorderedDemand = reconfigureDemandMatrix(vertices, demandMatrix);
-
-    return treeCost(tree, reorderedDemand);
+    return pisa::balancedTreeCost(vertices, pisa::sparseDemand::fromDense(demandMatrix));
 }
 
 double testOBST (
     const std::vector<uint32_t>& vertices, const std::vector<std::vector<double>>& demandMatrix
 ) {
-    std::vector<std::vector<double>> reorderedDemand = reconfigureDemandMatrix(vertices, demandMatrix);
-
-    return optimalBST(vertices.size(), reorderedDemand);
+    // interval cuts are read off the sparse demand by position; no reordered copy is built
+    return optimalBST(vertices, pisa::sparseDemand::fromDense(demandMatrix));
 }
 
 double testGreedy (
     const std::vector<uint32_t>& vertices, const std::vector<std::vector<double>>& demandMatrix
 ) {
-    std::vector<std::vector<double>> reorderedDemand = reconfigureDemandMatrix(vertices, demandMatrix);
-
-    return greedyConstructor(vertices.size(), reorderedDemand);
+    return greedyConstructor(vertices, pisa::sparseDemand::fromDense(demandMatrix));
 }
 
 template<typename Func>
@@ -96,9 +90,10 @@ void runOrdering (
     uint32_t maxDepth = (bounded ?
         static_cast<uint32_t>(std::ceil(std::log(nVertices)/std::log(2))) + 1: LINF
     );
-    const clock_t beginTime = std::clock();
+    // wall time: std::clock() would sum CPU time across the worker threads of a parallel run
+    const auto beginTime = std::chrono::steady_clock::now();
     reorderFn(demandMatrix, orderVec, limits, maxDepth, parallelize, record, maxIterations);
-    double secs = double(std::clock() - beginTime) / CLOCKS_PER_SEC;
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - beginTime).count();
     std::cout << "\tTime Spent: " << secs << std::endl;
 
     // write the ordering itself
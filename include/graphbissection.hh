@@ -1,13 +1,13 @@
 #pragma once
 
 
-#include <set>
 #include <memory>
 #include <vector>
 #include <algorithm>
 
 #include <core/util.hh>
 #include <core/bisectionRunRecord.hh>
+#include <core/bisectionTasks.hh>
 
 
 namespace basic {
@@ -17,45 +17,121 @@ struct CostGain_t {
     std::pair<uint32_t, uint32_t> vertices;
 };
 
-bool compareCostGainDecreasing (const CostGain_t& a, const CostGain_t& b) {
-    return a.costGain > b.costGain;
+inline double pairDemand (
+    const std::vector<std::vector<double>>& demandMatrix, uint32_t a, uint32_t b
+) {
+    return demandMatrix[a][b] + demandMatrix[b][a];
 }
 
-double computeCostGainBasic (
-    uint32_t leftVertex, uint32_t rightVertex,
-    const std::vector<std::vector<double>>& demandMatrix,
+// Kernighan-Lin D-value of the vertex at vIdx: demand towards the other side minus
+// demand inside its own side. Swapping a and b gains D(a) + D(b) - 2 * pairDemand(a, b).
+inline double computeDValue (
+    uint32_t vIdx, const std::vector<std::vector<double>>& demandMatrix,
     const std::vector<uint32_t>& vertices,
+    const VectorLimits_t& ownLimits, const VectorLimits_t& othLimits
+) {
+    uint32_t vertex = vertices[vIdx];
+    double dValue = 0;
+
+    for (uint32_t idx = ownLimits.leftLimit; idx < ownLimits.rightLimit; idx++) {
+        if (idx != vIdx)
+            dValue -= pairDemand(demandMatrix, vertex, vertices[idx]);
+    }
+
+    for (uint32_t idx = othLimits.leftLimit; idx < othLimits.rightLimit; idx++) {
+        dValue += pairDemand(demandMatrix, vertex, vertices[idx]);
+    }
+
+    return dValue;
+}
+
+// One Kernighan-Lin pass over the split: pairs are locked one at a time (best unlocked
+// left vertex by D-value, then its best right partner), D-values of the unlocked
+// vertices are updated as if the pair had been swapped, and finally the prefix of
+// tentative swaps with the largest cumulative gain is applied. O(n^2) per pass.
+// Returns the applied swaps as position pairs.
+inline std::vector<CostGain_t> kernighanLinPass (
+    const std::vector<std::vector<double>>& demandMatrix, std::vector<uint32_t>& vertices,
     const VectorLimits_t& leftLimits, const VectorLimits_t& rightLimits
 ) {
-    double costGain = 0;
+    uint32_t first = leftLimits.leftLimit;
+    uint32_t size = rightLimits.rightLimit - first;
+    std::vector<double> dValues(size);
+    std::vector<bool> locked(size, false);
 
     for (uint32_t idx = leftLimits.leftLimit; idx < leftLimits.rightLimit; idx++) {
-        uint32_t othLeft = vertices[idx];
-        if (othLeft == leftVertex || othLeft == rightVertex)
-            continue;
+        dValues[idx - first] = computeDValue(idx, demandMatrix, vertices, leftLimits, rightLimits);
+    }
+    for (uint32_t idx = rightLimits.leftLimit; idx < rightLimits.rightLimit; idx++) {
+        dValues[idx - first] = computeDValue(idx, demandMatrix, vertices, rightLimits, leftLimits);
+    }
+
+    std::vector<CostGain_t> tentative;
+    double cumulativeGain = 0, bestGain = 0;
+    size_t bestPrefix = 0;
+    uint32_t nPairs = std::min(
+        leftLimits.rightLimit - leftLimits.leftLimit, rightLimits.rightLimit - rightLimits.leftLimit
+    );
+
+    for (uint32_t step = 0; step < nPairs; step++) {
+        uint32_t leftIdx = leftLimits.rightLimit;
+        for (uint32_t idx = leftLimits.leftLimit; idx < leftLimits.rightLimit; idx++) {
+            if (locked[idx - first])
+                continue;
+
+            if (leftIdx == leftLimits.rightLimit || dValues[idx - first] > dValues[leftIdx - first])
+                leftIdx = idx;
+        }
+
+        uint32_t leftVertex = vertices[leftIdx];
+        uint32_t rightIdx = rightLimits.rightLimit;
+        double pairGain = 0;
+        for (uint32_t idx = rightLimits.leftLimit; idx < rightLimits.rightLimit; idx++) {
+            if (locked[idx - first])
+                continue;
+
+            double gain = dValues[leftIdx - first] + dValues[idx - first]
+                - 2 * pairDemand(demandMatrix, leftVertex, vertices[idx]);
+            if (rightIdx == rightLimits.rightLimit || gain > pairGain) {
+                rightIdx = idx;
+                pairGain = gain;
+            }
+        }
 
-        costGain -= demandMatrix[leftVertex][othLeft];
-        costGain -= demandMatrix[othLeft][leftVertex];
-        costGain += demandMatrix[rightVertex][othLeft];
-        costGain += demandMatrix[othLeft][rightVertex];
+        uint32_t rightVertex = vertices[rightIdx];
+        locked[leftIdx - first] = true;
+        locked[rightIdx - first] = true;
+        tentative.push_back({ pairGain, { leftIdx, rightIdx } });
 
+        cumulativeGain += pairGain;
+        if (cumulativeGain > bestGain && !isClose(cumulativeGain, bestGain)) {
+            bestGain = cumulativeGain;
+            bestPrefix = tentative.size();
+        }
+
+        for (uint32_t idx = leftLimits.leftLimit; idx < leftLimits.rightLimit; idx++) {
+            if (!locked[idx - first]) {
+                dValues[idx - first] += 2 * pairDemand(demandMatrix, vertices[idx], leftVertex)
+                    - 2 * pairDemand(demandMatrix, vertices[idx], rightVertex);
+            }
+        }
+        for (uint32_t idx = rightLimits.leftLimit; idx < rightLimits.rightLimit; idx++) {
+            if (!locked[idx - first]) {
+                dValues[idx - first] += 2 * pairDemand(demandMatrix, vertices[idx], rightVertex)
+                    - 2 * pairDemand(demandMatrix, vertices[idx], leftVertex);
+            }
+        }
     }
 
-    for (uint32_t idx = rightLimits.leftLimit; idx < rightLimits.rightLimit; idx++) {
-        uint32_t othRight = vertices[idx];
-        if (othRight == leftVertex || othRight == rightVertex)
-            continue;
-
-        costGain -= demandMatrix[rightVertex][othRight];
-        costGain -= demandMatrix[othRight][rightVertex];
-        costGain += demandMatrix[leftVertex][othRight];
-        costGain += demandMatrix[othRight][leftVertex];
+    tentative.resize(bestPrefix);
+    for (const auto& swap : tentative) {
+        std::swap(vertices[swap.vertices.first], vertices[swap.vertices.second]);
     }
 
-    return costGain;
+    return tentative;
 }
 
-void graphReordering (
+inline void graphReordering (
     const std::vector<std::vector<double>>& demandMatrix, std::vector<uint32_t>& vertices,
     const VectorLimits_t& vectorLimits, uint32_t maxDepth, bool parallelize, BisectionRunRecord& record,
     uint32_t maxIterations = 20
@@ -69,69 +145,30 @@ void graphReordering (
     VectorLimits_t rightLimits = { mid, vectorLimits.rightLimit };
 
     while (numIterations++ < maxIterations) {
-        std::vector<CostGain_t> costGains;
-        std::set<uint32_t> swappedVertices;
-
-        // #pragma omp parallel for collapse(2) shared(costGains) schedule(dynamic)
-        for (uint32_t leftIdx = leftLimits.leftLimit; leftIdx < leftLimits.rightLimit; leftIdx++) {
-            for (uint32_t rightIdx = rightLimits.leftLimit; rightIdx < rightLimits.rightLimit; rightIdx++) {
-                uint32_t leftVertex = vertices[leftIdx];
-                uint32_t rightVertex = vertices[rightIdx];
-                double costGain = computeCostGainBasic(
-                    leftVertex, rightVertex, demandMatrix, vertices, leftLimits, rightLimits
-                );
-
-                #pragma omp critical
-                {
-                    costGains.push_back({ costGain, { leftIdx, rightIdx }});
-                }
-            }
-        }
-
-        uint32_t bestCostGainIdx = std::max_element(
-            costGains.begin(), costGains.end(), compareCostGainDecreasing
-        ) - costGains.begin();
-
-        if (costGains[bestCostGainIdx].costGain <= 0)
+        std::vector<CostGain_t> swaps = kernighanLinPass(demandMatrix, vertices, leftLimits, rightLimits);
+        if (swaps.empty())
             break;
 
-        uint32_t leftIdx = costGains[bestCostGainIdx].vertices.first;
-        uint32_t rightIdx = costGains[bestCostGainIdx].vertices.second;
-
-        std::swap(vertices[leftIdx], vertices[rightIdx]);
+        double totalCostGain = 0;
+        for (const auto& swap : swaps) {
+            totalCostGain += swap.costGain;
+        }
 
-        record.recordSwappedPairs(1);
-        record.recordCostGain(costGains[bestCostGainIdx].costGain);
+        record.recordSwappedPairs(swaps.size());
+        record.recordCostGain(totalCostGain);
     }
 
     record.recordIterationCount(numIterations);
 
-    if (parallelize) {
-        throw std::runtime_error("Parallelization not implemented yet due to race condition on logger.");
-
-        #pragma omp single nowait
-        {
-            for (const auto& limits : { leftLimits, rightLimits }) {
-                #pragma omp task
-                graphReordering(
-                    demandMatrix, vertices, limits, maxDepth - 1,
-                    parallelize, record, maxIterations
-                );
-            }
-            #pragma omp taskwait
+    recurseOnHalves(
+        leftLimits, rightLimits, parallelize, record,
+        [&](const VectorLimits_t& limits, BisectionRunRecord& subRecord) {
+            graphReordering(
+                demandMatrix, vertices, limits, maxDepth - 1,
+                parallelize, subRecord, maxIterations
+            );
         }
-
-    } else {
-        graphReordering(
-            demandMatrix, vertices, leftLimits, maxDepth - 1,
-            parallelize, record, maxIterations
-        );
-        graphReordering(
-            demandMatrix, vertices, rightLimits, maxDepth - 1,
-            parallelize, record, maxIterations
-        );
-
-    }
+    );
 }
 
 }
@@ -1,12 +1,16 @@
 #pragma once
 
-#include <set>
 #include <memory>
 #include <vector>
 #include <algorithm>
 
+#include <tbb/enumerable_thread_specific.h>
+
 #include <core/util.hh>
 #include <core/bisectionRunRecord.hh>
+#include <core/bisectionTasks.hh>
+#include <util/singleInitVector.hh>
+#include <util/sparseDemand.hh>
 
 
 namespace mloggapa {
@@ -22,58 +26,99 @@ namespace mloggapa {
         double othSumWeight;
     };
 
-    bool compareCostGainDecreasing (const CostGain_t& a, const CostGain_t& b) {
+    enum Side_t : uint8_t { OUTSIDE = 0, LEFT = 1, RIGHT = 2 };
+
+    // CSR views of the demand matrix, built once per run and shared by every task.
+    // A symmetric demand keeps a single copy and serves its in-rows from outEdges.
+    struct Graph_t {
+        pisa::sparseDemand outEdges;    // row u: (v, demand[u][v])
+        pisa::sparseDemand inEdges;     // row v: (u, demand[u][v]); empty if symmetric
+        bool symmetric;
+
+        explicit Graph_t (pisa::sparseDemand demand, bool isSymmetric = false)
+            : outEdges(std::move(demand)),
+              inEdges(isSymmetric ? pisa::sparseDemand() : outEdges.transposed()),
+              symmetric(isSymmetric) {}
+
+        pisa::demandRow inRow (uint32_t vertex) const {
+            return symmetric ? outEdges.row(vertex) : inEdges.row(vertex);
+        }
+    };
+
+    // demand[u][v] + demand[v][u] over vertex IDs, as used by bipartiteGraphReordering.
+    inline Graph_t bipartiteGraph (const pisa::sparseDemand& demand) {
+        return Graph_t(demand.symmetrised(), true);
+    }
+
+    // Scratch of one thread, sized once for the whole run so iterations never allocate.
+    // sides[v] says on which half of the current split vertex v sits (OUTSIDE between
+    // splits), infos caches computeVertexInfo for the current iteration and swapped
+    // flags positions swapped in the current iteration; both are epoch-stamped.
+    struct Scratch_t {
+        std::vector<uint8_t> sides;
+        singleInitSoAVector<NodeSectionInfo_t> infos;
+        singleInitVector<bool> swapped;
+        std::vector<CostGain_t> leftGains, rightGains;
+
+        explicit Scratch_t (uint32_t numVertices)
+            : sides(numVertices, OUTSIDE), infos(numVertices), swapped(numVertices) {
+            leftGains.reserve(numVertices / 2 + 1);
+            rightGains.reserve(numVertices / 2 + 1);
+        }
+    };
+
+    // Per-run workspace: one Scratch_t per thread, reused by every split it processes.
+    struct Workspace_t {
+        tbb::enumerable_thread_specific<Scratch_t> scratch;
+
+        explicit Workspace_t (uint32_t numVertices) : scratch(numVertices) {}
+    };
+
+    inline bool compareCostGainDecreasing (const CostGain_t& a, const CostGain_t& b) {
         return a.costGain > b.costGain;
     }
 
-    NodeSectionInfo_t computeVertexInfo (
-        uint32_t vIdx, const std::vector<std::vector<double>>& demandMatrix,
-        const std::vector<uint32_t>& vertices,
-        const VectorLimits_t& fromLimits, const VectorLimits_t& toLimits
+    // Neighbour counts / weights of vertex ID `vertex` on both halves of the current
+    // split, O(out-degree).
+    inline NodeSectionInfo_t computeVertexInfo (
+        uint32_t vertex, const Graph_t& graph, const std::vector<uint8_t>& sides
     ) {
         NodeSectionInfo_t info = { 0, 0, 0, 0 };
-        uint32_t vertex = vertices[vIdx];
-
-        for (uint32_t othIdx = fromLimits.leftLimit; othIdx < fromLimits.rightLimit; othIdx++) {
-            uint32_t othVertex = vertices[othIdx];
-            double weight = demandMatrix[vertex][othVertex];
-            if (othVertex == vertex || isClose(weight, 0))
-                continue;
 
-            info.sameNeighbors++;
-            info.sameSumWeight += weight;
-        }
-
-        for (uint32_t othIdx = toLimits.leftLimit; othIdx < toLimits.rightLimit; othIdx++) {
-            uint32_t othVertex = vertices[othIdx];
-            double weight = demandMatrix[vertex][othVertex];
-            if (othVertex == vertex || isClose(weight, 0))
+        for (const auto& edge : graph.outEdges.row(vertex)) {
+            if (edge.dst == vertex || isClose(edge.weight, 0))
                 continue;
 
-            info.othNeighBors++;
-            info.othSumWeight += weight;
+            if (sides[edge.dst] == LEFT) {
+                info.sameNeighbors++;
+                info.sameSumWeight += edge.weight;
+            } else if (sides[edge.dst] == RIGHT) {
+                info.othNeighBors++;
+                info.othSumWeight += edge.weight;
+            }
         }
 
         return info;
     }
 
-    CostGain_t computeCostGain (
-        uint32_t vIdx, const std::vector<std::vector<double>>& demandMatrix,
-        const std::vector<uint32_t>& vertices, const std::vector<NodeSectionInfo_t>& nodeSectionInfo,
+    // Sums over the in-neighbours of the vertex at vIdx, O(in-degree) once their
+    // infos are cached.
+    inline CostGain_t computeCostGain (
+        uint32_t vIdx, const Graph_t& graph, const std::vector<uint32_t>& vertices,
+        const std::vector<uint8_t>& sides, singleInitSoAVector<NodeSectionInfo_t>& infos,
         const VectorLimits_t& fromLimits, const VectorLimits_t& toLimits
     ) {
         double costGain = 0;
-        uint32_t nVertices = vertices.size();
         uint32_t vertex = vertices[vIdx];
         uint32_t nTo = toLimits.rightLimit - toLimits.leftLimit;
         uint32_t nFrom = fromLimits.rightLimit - fromLimits.leftLimit;
 
-        for (uint32_t tIdx = 0; tIdx < nVertices; tIdx++) {
-            if (demandMatrix[tIdx][vertex] == 0) {
-                continue;
+        for (const auto& edge : graph.inRow(vertex)) {
+            uint32_t tIdx = edge.dst;
+            if (!infos.has_value(tIdx)) {
+                infos.set(tIdx, computeVertexInfo(tIdx, graph, sides));
             }
-
-            NodeSectionInfo_t vInfo = nodeSectionInfo[tIdx];
+            NodeSectionInfo_t vInfo = infos[tIdx];
 
             costGain += (
                 vInfo.sameSumWeight * log2(nTo / (double) (vInfo.sameNeighbors + 1))
@@ -93,43 +138,51 @@ namespace mloggapa {
         return {costGain, vIdx};
     }
 
-    void graphReordering (
-        const std::vector<std::vector<double>>& demandMatrix, std::vector<uint32_t>& vertices,
+    inline void sparseGraphReordering (
+        const Graph_t& graph, Workspace_t& workspace, std::vector<uint32_t>& vertices,
         const VectorLimits_t& vectorLimits, uint32_t maxDepth, bool parallelize, BisectionRunRecord& record,
         uint32_t maxIterations = 20
     ) {
         if (maxDepth == 0 || vectorLimits.rightLimit - vectorLimits.leftLimit <= 3)
             return;
 
-        uint32_t numVertices = vertices.size();
-        std::vector<NodeSectionInfo_t> partitionInfo(numVertices);
         uint32_t numIterations = 0;
         uint32_t mid = (vectorLimits.leftLimit + vectorLimits.rightLimit) / 2;
         VectorLimits_t leftLimits = { vectorLimits.leftLimit, mid };
         VectorLimits_t rightLimits = { mid, vectorLimits.rightLimit };
 
+        // the scratch is only used by this loop, so tasks this thread picks up
+        // while waiting on its children below may reuse it
+        Scratch_t& scratch = workspace.scratch.local();
+        auto& sides = scratch.sides;
+        auto& infos = scratch.infos;
+        auto& leftGains = scratch.leftGains;
+        auto& rightGains = scratch.rightGains;
+
+        for (uint32_t idx = leftLimits.leftLimit; idx < leftLimits.rightLimit; idx++)
+            sides[vertices[idx]] = LEFT;
+        for (uint32_t idx = rightLimits.leftLimit; idx < rightLimits.rightLimit; idx++)
+            sides[vertices[idx]] = RIGHT;
+
         while (numIterations++ < maxIterations) {
-            for (uint32_t tIdx = 0; tIdx < numVertices; tIdx++) {
-                partitionInfo[tIdx] = computeVertexInfo(
-                    tIdx, demandMatrix, vertices, leftLimits, rightLimits
-                );
-            }
+            infos.clear();
+            scratch.swapped.clear();
+            leftGains.clear();
+            rightGains.clear();
 
             uint32_t numSwapped = 0;
             double totalCostGain = 0;
-            std::vector<CostGain_t> leftGains, rightGains;
-            std::set<uint32_t> swappedVertices;
 
             for (uint32_t leftIdx = leftLimits.leftLimit; leftIdx < leftLimits.rightLimit; leftIdx++) {
                 leftGains.push_back(computeCostGain(
-                    leftIdx, demandMatrix, vertices, partitionInfo,
+                    leftIdx, graph, vertices, sides, infos,
                     leftLimits, rightLimits
                 ));
             }
 
             for (uint32_t rightIdx = rightLimits.leftLimit; rightIdx < rightLimits.rightLimit; rightIdx++) {
                 rightGains.push_back(computeCostGain(
-                    rightIdx, demandMatrix, vertices, partitionInfo,
+                    rightIdx, graph, vertices, sides, infos,
                     rightLimits, leftLimits
                 ));
             }
@@ -141,10 +194,7 @@ namespace mloggapa {
                 CostGain_t leftGain = leftGains[gainIdx];
                 CostGain_t rightGain = rightGains[gainIdx];
 
-                if (
-                    swappedVertices.find(leftGain.vIdx) != swappedVertices.end() ||
-                    swappedVertices.find(leftGain.vIdx) != swappedVertices.end()
-                ) {
+                if (scratch.swapped[leftGain.vIdx] || scratch.swapped[rightGain.vIdx]) {
                     continue;
 
                 } else if (leftGain.costGain + rightGain.costGain <= 0) {
@@ -156,62 +206,68 @@ namespace mloggapa {
                 numSwapped++;
 
                 std::swap(vertices[leftGain.vIdx], vertices[rightGain.vIdx]);
-                swappedVertices.insert(leftGain.vIdx);
-                swappedVertices.insert(rightGain.vIdx);
+                sides[vertices[leftGain.vIdx]] = LEFT;
+                sides[vertices[rightGain.vIdx]] = RIGHT;
+                scratch.swapped.set(leftGain.vIdx, true);
+                scratch.swapped.set(rightGain.vIdx, true);
             }
 
             record.recordSwappedPairs(numSwapped);
             record.recordCostGain(totalCostGain);
 
-            if (swappedVertices.size() == 0)
+            if (numSwapped == 0)
                 break;
         }
 
+        for (uint32_t idx = vectorLimits.leftLimit; idx < vectorLimits.rightLimit; idx++)
+            sides[vertices[idx]] = OUTSIDE;
+
         record.recordIterationCount(numIterations);
 
-        if (parallelize) {
-            throw std::runtime_error("Parallelization not implemented yet due to race condition on logger.");
-
-            #pragma omp single nowait
-            {
-                for (const auto& limits : { leftLimits, rightLimits }) {
-                    #pragma omp task
-                    graphReordering(
-                        demandMatrix, vertices, limits, maxDepth - 1, parallelize,
-                        record, maxIterations
-                    );
-                }
-                #pragma omp taskwait
+        recurseOnHalves(
+            leftLimits, rightLimits, parallelize, record,
+            [&](const VectorLimits_t& limits, BisectionRunRecord& subRecord) {
+                sparseGraphReordering(
+                    graph, workspace, vertices, limits, maxDepth - 1,
+                    parallelize, subRecord, maxIterations
+                );
             }
-
-        } else {
-            graphReordering(
-                demandMatrix, vertices, leftLimits, maxDepth - 1,
-                parallelize, record, maxIterations
-            );
-            graphReordering(
-                demandMatrix, vertices, rightLimits, maxDepth - 1,
-                parallelize,  record, maxIterations
-            );
-        }
+        );
     }
 
-    void bipartiteGraphReordering (
+    inline void graphReordering (
         const std::vector<std::vector<double>>& demandMatrix, std::vector<uint32_t>& vertices,
         const VectorLimits_t& vectorLimits, uint32_t maxDepth, bool parallelize, BisectionRunRecord& record,
         uint32_t maxIterations = 20
     ) {
-        uint32_t nVertices = vertices.size();
-        std::vector<std::vector<double>> demandMatrixCopy(nVertices, std::vector<double>(nVertices, 0.0));
-        for (uint32_t i = 0; i < vertices.size(); i++) {
-            for (uint32_t j = 0; j < vertices.size(); j++) {
-                demandMatrixCopy[i][j] = (
-                    demandMatrix[vertices[i]][vertices[j]] + demandMatrix[vertices[j]][vertices[i]]
-                );
-            }
-        }
+        Graph_t graph(pisa::sparseDemand::fromDense(demandMatrix));
+        Workspace_t workspace(vertices.size());
+        sparseGraphReordering(
+            graph, workspace, vertices, vectorLimits, maxDepth, parallelize, record, maxIterations
+        );
+    }
 
-        graphReordering(demandMatrixCopy, vertices, vectorLimits, maxDepth, parallelize, record, maxIterations);
+    // Reorders over the symmetrised demand; `graph` is typically built once with
+    // bipartiteGraph() and shared by every run in the process.
+    inline void bipartiteGraphReordering (
+        const Graph_t& graph, std::vector<uint32_t>& vertices,
+        const VectorLimits_t& vectorLimits, uint32_t maxDepth, bool parallelize, BisectionRunRecord& record,
+        uint32_t maxIterations = 20
+    ) {
+        Workspace_t workspace(vertices.size());
+        sparseGraphReordering(
+            graph, workspace, vertices, vectorLimits, maxDepth, parallelize, record, maxIterations
+        );
     }
-}
 
+    inline void bipartiteGraphReordering (
+        const std::vector<std::vector<double>>& demandMatrix, std::vector<uint32_t>& vertices,
+        const VectorLimits_t& vectorLimits, uint32_t maxDepth, bool parallelize, BisectionRunRecord& record,
+        uint32_t maxIterations = 20
+    ) {
+        bipartiteGraphReordering(
+            bipartiteGraph(pisa::sparseDemand::fromDense(demandMatrix)),
+            vertices, vectorLimits, maxDepth, parallelize, record, maxIterations
+        );
+    }
+}
@@ -1,12 +1,15 @@
 #pragma once
 
-#include <set>
 #include <memory>
 #include <vector>
 #include <algorithm>
 
+#include <tbb/enumerable_thread_specific.h>
+
 #include <core/util.hh>
 #include <core/bisectionRunRecord.hh>
+#include <core/bisectionTasks.hh>
+#include <util/singleInitVector.hh>
 
 
 namespace onehop {
@@ -22,11 +25,30 @@ namespace onehop {
         double othSumWeight;
     };
 
-    bool compareCostGainDecreasing (const CostGain_t& a, const CostGain_t& b) {
+    // Scratch of one thread, sized once for the whole run so iterations never allocate;
+    // swapped flags positions swapped in the current iteration (epoch-stamped).
+    struct Scratch_t {
+        singleInitVector<bool> swapped;
+        std::vector<CostGain_t> leftGains, rightGains;
+
+        explicit Scratch_t (uint32_t numVertices) : swapped(numVertices) {
+            leftGains.reserve(numVertices / 2 + 1);
+            rightGains.reserve(numVertices / 2 + 1);
+        }
+    };
+
+    // Per-run workspace: one Scratch_t per thread, reused by every split it processes.
+    struct Workspace_t {
+        tbb::enumerable_thread_specific<Scratch_t> scratch;
+
+        explicit Workspace_t (uint32_t numVertices) : scratch(numVertices) {}
+    };
+
+    inline bool compareCostGainDecreasing (const CostGain_t& a, const CostGain_t& b) {
         return a.costGain > b.costGain;
     }
 
-    NodeSectionInfo_t computeVertexInfo (
+    inline NodeSectionInfo_t computeVertexInfo (
         uint32_t vIdx, const std::vector<std::vector<double>>& demandMatrix,
         const std::vector<uint32_t>& vertices,
         const VectorLimits_t& fromLimits, const VectorLimits_t& toLimits
@@ -57,7 +79,7 @@ namespace onehop {
         return info;
     }
 
-    CostGain_t computeCostGain (
+    inline CostGain_t computeCostGain (
         uint32_t vIdx, const std::vector<std::vector<double>>& demandMatrix,
         const std::vector<uint32_t>& vertices,
         const VectorLimits_t& fromLimits, const VectorLimits_t& toLimits
@@ -86,10 +108,10 @@ namespace onehop {
         return {costGain, vIdx};
     }
 
-    void graphReordering (
-        const std::vector<std::vector<double>>& demandMatrix, std::vector<uint32_t>& vertices,
-        const VectorLimits_t& vectorLimits, uint32_t maxDepth, bool parallelize, BisectionRunRecord& record,
-        uint32_t maxIterations = 20
+    inline void reorderWithWorkspace (
+        const std::vector<std::vector<double>>& demandMatrix, Workspace_t& workspace,
+        std::vector<uint32_t>& vertices, const VectorLimits_t& vectorLimits, uint32_t maxDepth,
+        bool parallelize, BisectionRunRecord& record, uint32_t maxIterations = 20
     ) {
         if (maxDepth == 0 || vectorLimits.rightLimit - vectorLimits.leftLimit <= 3)
             return;
@@ -99,11 +121,18 @@ namespace onehop {
         VectorLimits_t leftLimits = { vectorLimits.leftLimit, mid };
         VectorLimits_t rightLimits = { mid, vectorLimits.rightLimit };
 
+        // only used by this loop, so tasks this thread picks up while waiting on
+        // its children below may reuse it
+        Scratch_t& scratch = workspace.scratch.local();
+        auto& leftGains = scratch.leftGains;
+        auto& rightGains = scratch.rightGains;
+
         while (numIterations++ < maxIterations) {
             uint32_t numSwapped = 0;
             double totalCostGain = 0;
-            std::vector<CostGain_t> leftGains, rightGains;
-            std::set<uint32_t> swappedVertices;
+            scratch.swapped.clear();
+            leftGains.clear();
+            rightGains.clear();
 
             for (uint32_t leftIdx = leftLimits.leftLimit; leftIdx < leftLimits.rightLimit; leftIdx++) {
                 leftGains.push_back(computeCostGain(leftIdx, demandMatrix, vertices, leftLimits, rightLimits));
@@ -120,10 +149,7 @@ namespace onehop {
                 CostGain_t leftGain = leftGains[gainIdx];
                 CostGain_t rightGain = rightGains[gainIdx];
 
-                if (
-                    swappedVertices.find(leftGain.vIdx) != swappedVertices.end() ||
-                    swappedVertices.find(leftGain.vIdx) != swappedVertices.end()
-                ) {
+                if (scratch.swapped[leftGain.vIdx] || scratch.swapped[rightGain.vIdx]) {
                     continue;
                 } else if (leftGain.costGain + rightGain.costGain <= 0) {
                     break;
@@ -133,44 +159,39 @@ namespace onehop {
                 numSwapped++;
 
                 std::swap(vertices[leftGain.vIdx], vertices[rightGain.vIdx]);
-                swappedVertices.insert(leftGain.vIdx);
-                swappedVertices.insert(rightGain.vIdx);
+                scratch.swapped.set(leftGain.vIdx, true);
+                scratch.swapped.set(rightGain.vIdx, true);
             }
 
             record.recordSwappedPairs(numSwapped);
             record.recordCostGain(totalCostGain);
 
-            if (swappedVertices.size() == 0)
+            if (numSwapped == 0)
                 break;
         }
 
         record.recordIterationCount(numIterations);
 
-        if (parallelize) {
-            throw std::runtime_error("Parallelization not implemented yet due to race condition on logger.");
-
-            #pragma omp single nowait
-            {
-                for (const auto& limits : { leftLimits, rightLimits }) {
-                    #pragma omp task
-                    graphReordering(
-                        demandMatrix, vertices, limits, maxDepth - 1, parallelize,
-                        record, maxIterations
-                    );
-                }
-                #pragma omp taskwait
+        recurseOnHalves(
+            leftLimits, rightLimits, parallelize, record,
+            [&](const VectorLimits_t& limits, BisectionRunRecord& subRecord) {
+                reorderWithWorkspace(
+                    demandMatrix, workspace, vertices, limits, maxDepth - 1,
+                    parallelize, subRecord, maxIterations
+                );
             }
+        );
+    }
 
-        } else {
-            graphReordering(
-                demandMatrix, vertices, leftLimits, maxDepth - 1,
-                parallelize, record, maxIterations
-            );
-            graphReordering(
-                demandMatrix, vertices, rightLimits, maxDepth - 1,
-                parallelize,  record, maxIterations
-            );
-        }
+    inline void graphReordering (
+        const std::vector<std::vector<double>>& demandMatrix, std::vector<uint32_t>& vertices,
+        const VectorLimits_t& vectorLimits, uint32_t maxDepth, bool parallelize, BisectionRunRecord& record,
+        uint32_t maxIterations = 20
+    ) {
+        Workspace_t workspace(vertices.size());
+        reorderWithWorkspace(
+            demandMatrix, workspace, vertices, vectorLimits, maxDepth, parallelize, record, maxIterations
+        );
     }
 
 }
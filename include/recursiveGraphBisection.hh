@@ -1,15 +1,25 @@
 #pragma once
 
+#include <algorithm>
+#include <cassert>
 #include <cmath>
 #include <iterator>
+#include <limits>
+#include <numeric>
 #include <vector>
 
+#include "tbb/blocked_range.h"
 #include "tbb/enumerable_thread_specific.h"
+#include "tbb/parallel_for.h"
 #include "tbb/parallel_invoke.h"
+#include "tbb/parallel_sort.h"
+#include "tbb/task_arena.h"
 #include "tbb/task_group.h"
 
+#include "core/bisectionRunRecord.hh"
 #include "util/compilerAttribute.hh"
 #include "util/forwardIndex.hh"
+#include "util/gainKernel.hh"
 #include "util/log.hh"
 #include "util/singleInitVector.hh"
 
@@ -18,13 +28,26 @@ const Log2<4096> log2;
 
 namespace bp {
 
-    using ThreadLocalGains = tbb::enumerable_thread_specific<singleInitVector<double>>;
-    using ThreadLocalDegrees = tbb::enumerable_thread_specific<singleInitVector<size_t>>;
+    using ThreadLocalGains = tbb::enumerable_thread_specific<singleInitSoAVector<double>>;
+    using ThreadLocalDegrees = tbb::enumerable_thread_specific<degreeMap>;
+    using ThreadLocalFlags = tbb::enumerable_thread_specific<singleInitVector<bool>>;
+    using ThreadLocalRecords = tbb::enumerable_thread_specific<BisectionRunRecord>;
 
     struct ThreadLocal {
         ThreadLocalGains gains;
         ThreadLocalDegrees left_degrees;
         ThreadLocalDegrees right_degrees;
+        ThreadLocalDegrees term_slots;
+        ThreadLocalDegrees vertex_rows;
+        ThreadLocalFlags stale_vertices;
+        ThreadLocalRecords records{BisectionRunRecord(RunConfig{})};
+        moveGainTable gain_table;
+        moveDeltaFn move_deltas = nullptr;
+    };
+
+    struct swapStats {
+        std::size_t pairs = 0;
+        double gain = 0.0;
     };
 
     ALWAYSINLINE double expb(double logn1, double logn2, size_t deg1, size_t deg2) {
@@ -34,6 +57,12 @@ namespace bp {
              - static_cast<double>(deg2) * log2(static_cast<double>(deg2) + 1.0);
     };
 
+    ALWAYSINLINE double termGain(double logn1, double logn2, size_t from_deg, size_t to_deg) {
+        return expb(logn1, logn2, from_deg, to_deg) - expb(logn1, logn2, from_deg - 1, to_deg + 1);
+    }
+
+    /// Maps are only ever grown: a thread that first served a locally
+    /// renumbered subtree may later need the global term space.
     template <typename ThreadLocalContainer>
     [[nodiscard]] ALWAYSINLINE auto&
     clearOrInit(ThreadLocalContainer&& container, std::size_t size) {
@@ -41,14 +70,103 @@ namespace bp {
         auto& ref = container.local(exists);
         if (exists) {
             ref.clear();
-        } else {
+        }
+        if (ref.size() < size) {
             ref.resize(size);
         }
         return ref;
     }
 
+    /// The forward index restricted to one partition, with its terms renumbered
+    /// densely (local IDs, in order of first appearance). Row r holds the local
+    /// terms of vertices[r].
+    struct localTermSpace {
+        std::vector<uint32_t> global_terms;
+        std::vector<uint32_t> vertices;
+        std::vector<uint32_t> offsets{0};
+        std::vector<uint32_t> terms;
+
+        [[nodiscard]] std::size_t size() const { return global_terms.size(); }
+        [[nodiscard]] termSpan row(uint32_t r) const {
+            return {terms.data() + offsets[r], terms.data() + offsets[r + 1]};
+        }
+    };
+
+    /// A compact copy of the forward index restricted to one subtree: vertices
+    /// are renumbered by rank (local v <-> global_vertices[v]) and terms in
+    /// order of first appearance, so the subtree's degree and gain lookups stay
+    /// within the first few entries of every thread-local map.
+    struct subIndex {
+        forwardIndex fwdidx;
+        std::vector<uint32_t> global_vertices;
+        std::vector<uint32_t> vertices;
+        std::vector<double> gains;
+    };
+
+    /// Local term -> vertices inverted index of one partition.
+    struct termPostings {
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> vertices;
+    };
+
 }  // namespace bp
 
+/// How each pass orders the two halves before swap() consumes their prefixes.
+enum class selectionStrategy {
+    /// Sort both halves entirely by gain.
+    fullSort,
+    /// Move only vertices that can still form a positive pair to the front
+    /// (gain > -max gain of the other half) and sort just that prefix.
+    candidatesOnly,
+};
+
+struct bisectionConfig {
+    /// After the first pass of a level, recompute gains only for vertices that
+    /// share a term with a swapped vertex, and stop once a pass swaps nothing.
+    bool incremental_gains = false;
+
+    /// Evaluate gains from a d * log2(d + 1) delta table sized to the largest term
+    /// degree, with an AVX2 / AVX-512 / scalar kernel picked at runtime, instead of
+    /// lazily caching expb() per term.
+    bool vectorised_gains = false;
+
+    /// A level stops iterating once a pass swaps nothing or its cumulative
+    /// gain falls below this threshold.
+    double min_pass_gain = 0.0;
+
+    selectionStrategy selection = selectionStrategy::fullSort;
+
+    /// Halves at least this large are sorted with tbb::parallel_sort instead of
+    /// one std::sort per half, so the top levels do not leave cores idle.
+    std::ptrdiff_t parallel_sort_threshold = 1 << 15;
+
+    /// Partitions at least this large compute degrees, gains and swap degree
+    /// updates in parallel; gains are split into blocks of parallel_grain_size.
+    std::ptrdiff_t parallel_gain_threshold = 1 << 12;
+    std::ptrdiff_t parallel_grain_size = 512;
+
+    /// Renumber each partition's terms locally and, once per pass, fill a dense
+    /// gain table over them; vertex gains are then gather-sums over that table.
+    /// Replaces the per-term gain cache, so cache_depth is ignored.
+    bool partition_term_gains = false;
+
+    /// Subtrees with at most this many vertices (0 = never) recurse on a
+    /// bp::subIndex with locally renumbered vertices and terms. Orderings are
+    /// unchanged; deep levels just stop striding across global-sized maps.
+    std::ptrdiff_t local_term_threshold = 0;
+
+    /// After each level, copy both halves into their own bp::subIndex and drop
+    /// terms held by a single vertex of the half. Deeper levels read contiguous
+    /// memory and skip terms that cannot change the cost; since those terms no
+    /// longer bias odd-sized splits, orderings may differ from the default.
+    /// Supersedes local_term_threshold.
+    bool child_subindexes = false;
+
+    /// Optional sink for per-pass swapped pairs / gain and per-level pass
+    /// counts. Samples are gathered per thread and merged once the run ends.
+    BisectionRunRecord* record = nullptr;
+};
+
 template <class Iterator>
 struct verticePartition;
 
@@ -85,15 +203,20 @@ class verticeRange {
     }
 
     std::size_t term_count() const { return m_fwdidx.get().termCount(); }
-    std::vector<uint32_t> terms(value_type vertice) const {
-        return m_fwdidx.get().terms(vertice);
+    std::size_t vertice_count() const { return m_gains.get().size(); }
+    termSpan terms(value_type vertice) const {
+        return m_fwdidx.get().termsView(vertice);
     }
     double gain(value_type vertice) const { return m_gains.get()[vertice]; }
     double& gain(value_type vertice) { return m_gains.get()[vertice]; }
 
+    /// Descending gain, equal gains by ascending vertex, so the order of a sorted
+    /// range does not depend on the order it was in before.
     auto by_gain() {
         return [this](const value_type& lhs, const value_type& rhs) {
-            return m_gains.get()[lhs] > m_gains.get()[rhs];
+            const double l = m_gains.get()[lhs];
+            const double r = m_gains.get()[rhs];
+            return l > r || (l == r && lhs < rhs);
         };
     }
 
@@ -114,9 +237,9 @@ struct verticePartition {
 };
 
 template <class Iterator>
-void computeDegrees(verticeRange<Iterator>& range, singleInitVector<size_t>& deg_map) {
+void computeDegrees(verticeRange<Iterator>& range, degreeMap& deg_map) {
     for (const auto& vertice: range) {
-        auto terms = range.terms(vertice);
+        const auto terms = range.terms(vertice);
         auto deg_map_inc = [&](const auto& t) { deg_map.set(t, deg_map[t] + 1); };
         std::for_each(terms.begin(), terms.end(), deg_map_inc);
     }
@@ -127,8 +250,8 @@ void computeMoveGainsCaching(
     verticeRange<Iter>& range,
     const std::ptrdiff_t from_n,
     const std::ptrdiff_t to_n,
-    const singleInitVector<size_t>& from_lex,
-    const singleInitVector<size_t>& to_lex,
+    const degreeMap& from_lex,
+    const degreeMap& to_lex,
     bp::ThreadLocal& thread_local_data
 ) {
     const auto logn1 = log2(from_n);
@@ -137,23 +260,15 @@ void computeMoveGainsCaching(
     auto& gain_cache = bp::clearOrInit(thread_local_data.gains, from_lex.size());
     auto computeVerticeGain = [&](auto& d) {
         double gain = 0.0;
-        auto terms = range.terms(d);
+        const auto terms = range.terms(d);
         for (const auto& t: terms) {
             if constexpr (isLikelyCached) {  // NOLINT(readability-braces-around-statements)
                 if (not gain_cache.has_value(t)) [[unlikely]] {
-                    const auto& from_deg = from_lex[t];
-                    const auto& to_deg = to_lex[t];
-                    const auto term_gain = bp::expb(logn1, logn2, from_deg, to_deg)
-                        - bp::expb(logn1, logn2, from_deg - 1, to_deg + 1);
-                    gain_cache.set(t, term_gain);
+                    gain_cache.set(t, bp::termGain(logn1, logn2, from_lex[t], to_lex[t]));
                 }
             } else {
                 if (not gain_cache.has_value(t)) [[likely]] {
-                    const auto& from_deg = from_lex[t];
-                    const auto& to_deg = to_lex[t];
-                    const auto term_gain = bp::expb(logn1, logn2, from_deg, to_deg)
-                        - bp::expb(logn1, logn2, from_deg - 1, to_deg + 1);
-                    gain_cache.set(t, term_gain);
+                    gain_cache.set(t, bp::termGain(logn1, logn2, from_lex[t], to_lex[t]));
                 }
             }
             gain += gain_cache[t];
@@ -163,46 +278,354 @@ void computeMoveGainsCaching(
     std::for_each(range.begin(), range.end(), computeVerticeGain);
 }
 
+/// Table-driven gain pass: no per-term cache and no log evaluation, just
+/// gathered degrees and two table loads per term (see bp::moveGainTable).
+template <typename Iter>
+void computeMoveGainsVectorised(
+    verticeRange<Iter>& range,
+    const std::ptrdiff_t from_n,
+    const std::ptrdiff_t to_n,
+    const degreeMap& from_lex,
+    const degreeMap& to_lex,
+    bp::ThreadLocal& thread_local_data
+) {
+    const auto size_gain = log2(from_n) - log2(to_n);
+    const auto& table = thread_local_data.gain_table;
+    const auto move_deltas = thread_local_data.move_deltas;
+    for (const auto& d: range) {
+        const auto terms = range.terms(d);
+        range.gain(d) = static_cast<double>(terms.size()) * size_gain
+            + move_deltas(terms, from_lex, to_lex, table);
+    }
+}
+
+/// Recomputes the move gain of the vertices flagged in @p stale only; the
+/// gains of every other vertex in @p range are left as they are.
+template <typename Iter>
+void computeStaleMoveGains(
+    verticeRange<Iter>& range,
+    const std::ptrdiff_t from_n,
+    const std::ptrdiff_t to_n,
+    const degreeMap& from_lex,
+    const degreeMap& to_lex,
+    const singleInitVector<bool>& stale,
+    bp::ThreadLocal& thread_local_data
+) {
+    if (not thread_local_data.gain_table.empty()) {
+        const auto size_gain = log2(from_n) - log2(to_n);
+        for (const auto& d: range) {
+            if (stale[d]) {
+                const auto terms = range.terms(d);
+                range.gain(d) = static_cast<double>(terms.size()) * size_gain
+                    + thread_local_data.move_deltas(terms, from_lex, to_lex, thread_local_data.gain_table);
+            }
+        }
+        return;
+    }
+
+    const auto logn1 = log2(from_n);
+    const auto logn2 = log2(to_n);
+
+    auto& gain_cache = bp::clearOrInit(thread_local_data.gains, from_lex.size());
+    for (const auto& d: range) {
+        if (not stale[d]) [[likely]] {
+            continue;
+        }
+        double gain = 0.0;
+        for (const auto& t: range.terms(d)) {
+            if (not gain_cache.has_value(t)) {
+                gain_cache.set(t, bp::termGain(logn1, logn2, from_lex[t], to_lex[t]));
+            }
+            gain += gain_cache[t];
+        }
+        range.gain(d) = gain;
+    }
+}
+
+/// Renumbers the terms of @p partition densely. @p slots receives the global ->
+/// local term mapping and @p rows the vertex -> row mapping.
+template <class Iterator>
+bp::localTermSpace
+buildLocalTermSpace(verticePartition<Iterator>& partition, degreeMap& slots, degreeMap& rows) {
+    bp::localTermSpace space;
+    space.vertices.reserve(partition.size());
+    space.offsets.reserve(partition.size() + 1);
+    auto add = [&](auto& range) {
+        for (const auto& vertice: range) {
+            rows.set(vertice, space.vertices.size());
+            space.vertices.push_back(vertice);
+            for (const auto& t: range.terms(vertice)) {
+                if (not slots.has_value(t)) {
+                    slots.set(t, space.global_terms.size());
+                    space.global_terms.push_back(t);
+                }
+                space.terms.push_back(slots[t]);
+            }
+            space.offsets.push_back(space.terms.size());
+        }
+    };
+    add(partition.left);
+    add(partition.right);
+    return space;
+}
+
+/// Copies the terms of @p range into a bp::subIndex; @p slots receives the
+/// global -> local term mapping. With @p min_term_degree > 1, terms held by
+/// fewer vertices of @p range are dropped (their degrees are counted in
+/// @p counts): a term on a single vertex has no gaps left to shorten, so it
+/// cannot change the cost of any ordering below this point.
+/// @p range must be sorted by vertex.
+template <class Iterator>
+bp::subIndex extractSubIndex(
+    verticeRange<Iterator>& range, degreeMap& slots, degreeMap* counts = nullptr, uint32_t min_term_degree = 1
+) {
+    if (min_term_degree > 1) {
+        assert(counts != nullptr);
+        computeDegrees(range, *counts);
+    }
+    bp::subIndex sub;
+    std::vector<uint32_t> terms;
+    std::vector<uint32_t> offsets{0};
+    offsets.reserve(range.size() + 1);
+    uint32_t term_count = 0;
+    for (const auto& vertice: range) {
+        for (const auto& t: range.terms(vertice)) {
+            if (min_term_degree > 1 && (*counts)[t] < min_term_degree) {
+                continue;
+            }
+            if (not slots.has_value(t)) {
+                slots.set(t, term_count++);
+            }
+            terms.push_back(slots[t]);
+        }
+        offsets.push_back(terms.size());
+    }
+    sub.fwdidx = forwardIndex(std::move(terms), std::move(offsets), term_count);
+    sub.global_vertices.assign(range.begin(), range.end());
+    sub.vertices.resize(sub.global_vertices.size());
+    std::iota(sub.vertices.begin(), sub.vertices.end(), 0);
+    sub.gains.assign(sub.global_vertices.size(), 0.0);
+    return sub;
+}
+
+inline bp::termPostings buildPostings(const bp::localTermSpace& space) {
+    bp::termPostings postings;
+    postings.offsets.assign(space.size() + 1, 0);
+    for (const auto& l: space.terms) {
+        ++postings.offsets[l + 1];
+    }
+    for (std::size_t l = 0; l < space.size(); ++l) {
+        postings.offsets[l + 1] += postings.offsets[l];
+    }
+    postings.vertices.resize(space.terms.size());
+    std::vector<uint32_t> cursor(postings.offsets.begin(), postings.offsets.end() - 1);
+    for (uint32_t r = 0; r < space.vertices.size(); ++r) {
+        for (const auto& l: space.row(r)) {
+            postings.vertices[cursor[l]++] = space.vertices[r];
+        }
+    }
+    return postings;
+}
+
+/// Dense term gains over a partition's local term space: one entry per local
+/// term for each move direction, so vertex gains become a plain gather-sum
+/// without any cache lookups. Partition sizes are fixed within a level, so after
+/// the first pass only the local terms in @p dirty_terms need refreshing.
+template <class Iterator>
+void computeTermGains(
+    const verticePartition<Iterator>& partition,
+    const degreeMapPair& degrees,
+    const bp::localTermSpace& space,
+    std::vector<double>& left_term_gains,
+    std::vector<double>& right_term_gains,
+    const bp::ThreadLocal& thread_local_data,
+    const bisectionConfig& config,
+    const std::vector<uint32_t>* dirty_terms = nullptr
+) {
+    const auto logn1 = log2(partition.left.size());
+    const auto logn2 = log2(partition.right.size());
+    const auto& table = thread_local_data.gain_table;
+    auto gain_at = [&](double from_log, double to_log, uint32_t from_deg, uint32_t to_deg) {
+        if (from_deg == 0) {
+            return 0.0;  // no vertex on this side holds the term
+        }
+        if (not table.empty()) {
+            return from_log - to_log + table.from_data()[from_deg] + table.to_data()[to_deg];
+        }
+        return bp::termGain(from_log, to_log, from_deg, to_deg);
+    };
+    auto update = [&](uint32_t l) {
+        const auto t = space.global_terms[l];
+        const auto left_deg = degrees.left[t];
+        const auto right_deg = degrees.right[t];
+        left_term_gains[l] = gain_at(logn1, logn2, left_deg, right_deg);
+        right_term_gains[l] = gain_at(logn2, logn1, right_deg, left_deg);
+    };
+    if (dirty_terms != nullptr) {
+        std::for_each(dirty_terms->begin(), dirty_terms->end(), update);
+        return;
+    }
+    left_term_gains.resize(space.size());
+    right_term_gains.resize(space.size());
+    if (static_cast<std::ptrdiff_t>(space.size()) < config.parallel_gain_threshold) {
+        for (uint32_t l = 0; l < space.size(); ++l) {
+            update(l);
+        }
+        return;
+    }
+    tbb::parallel_for(
+        tbb::blocked_range<uint32_t>(0, space.size(), config.parallel_grain_size),
+        [&](const tbb::blocked_range<uint32_t>& block) {
+            for (auto l = block.begin(); l < block.end(); ++l) {
+                update(l);
+            }
+        }
+    );
+}
+
+/// Large partitions are split into blocks; every block is a separate
+/// gainFunction call, so each one starts from a freshly cleared gain cache of
+/// whichever thread runs it and no cache is shared between threads.
 template <class Iterator, class GainF>
 void computeGains(
     verticePartition<Iterator>& partition,
     const degreeMapPair& degrees,
     GainF gainFunction,
-    bp::ThreadLocal& thread_local_data
+    bp::ThreadLocal& thread_local_data,
+    const bisectionConfig& config = {}
 ) {
     auto n1 = partition.left.size();
     auto n2 = partition.right.size();
-    gainFunction(partition.left, n1, n2, degrees.left, degrees.right, thread_local_data);
-    gainFunction(partition.right, n2, n1, degrees.right, degrees.left, thread_local_data);
+    if (partition.size() < config.parallel_gain_threshold) {
+        gainFunction(partition.left, n1, n2, degrees.left, degrees.right, thread_local_data);
+        gainFunction(partition.right, n2, n1, degrees.right, degrees.left, thread_local_data);
+        return;
+    }
+
+    auto blocked = [&](auto& range, auto from_n, auto to_n, const auto& from_lex, const auto& to_lex) {
+        tbb::parallel_for(
+            tbb::blocked_range<std::ptrdiff_t>(0, range.size(), config.parallel_grain_size),
+            [&](const tbb::blocked_range<std::ptrdiff_t>& block) {
+                auto chunk = range(block.begin(), block.end());
+                gainFunction(chunk, from_n, to_n, from_lex, to_lex, thread_local_data);
+            }
+        );
+    };
+    tbb::parallel_invoke(
+        [&] { blocked(partition.left, n1, n2, degrees.left, degrees.right); },
+        [&] { blocked(partition.right, n2, n1, degrees.right, degrees.left); }
+    );
 }
 
+/// Swaps the sorted prefixes while the pair gain is positive and reports how many
+/// pairs moved and their summed gain; terms whose degrees changed are appended to
+/// @p touched_terms. Each side's degree map is updated by its own task once the
+/// prefix reaches @p parallel_threshold pairs.
 template <class Iterator>
-void swap(verticePartition<Iterator>& partition, degreeMapPair& degrees) {
+bp::swapStats swap(
+    verticePartition<Iterator>& partition,
+    degreeMapPair& degrees,
+    std::vector<uint32_t>* touched_terms = nullptr,
+    std::ptrdiff_t parallel_threshold = std::numeric_limits<std::ptrdiff_t>::max()
+) {
     auto left = partition.left;
     auto right = partition.right;
     auto lit = left.begin();
     auto rit = right.begin();
+    bp::swapStats stats;
     for (; lit != left.end() && rit != right.end(); ++lit, ++rit) {
-        if (left.gain(*lit) + right.gain(*rit) <= 0) [[unlikely]] {
+        const double pair_gain = left.gain(*lit) + right.gain(*rit);
+        if (pair_gain <= 0) [[unlikely]] {
             break;
         }
-        {
-            auto terms = left.terms(*lit);
-            for (auto& term: terms) {
-                degrees.left.set(term, degrees.left[term] - 1);
-                degrees.right.set(term, degrees.right[term] + 1);
+        ++stats.pairs;
+        stats.gain += pair_gain;
+    }
+
+    // left vertices lose a term occurrence on the left and gain one on the right
+    auto update = [&](degreeMap& deg_map, int from_left, int from_right) {
+        for (auto l = left.begin(); l != lit; ++l) {
+            for (const auto& term: left.terms(*l)) {
+                deg_map.set(term, deg_map[term] + from_left);
             }
         }
-        {
-            auto terms = right.terms(*rit);
-            for (auto& term: terms) {
-                degrees.left.set(term, degrees.left[term] + 1);
-                degrees.right.set(term, degrees.right[term] - 1);
+        for (auto r = right.begin(); r != rit; ++r) {
+            for (const auto& term: right.terms(*r)) {
+                deg_map.set(term, deg_map[term] + from_right);
             }
         }
+    };
+    if (static_cast<std::ptrdiff_t>(stats.pairs) >= parallel_threshold) {
+        tbb::parallel_invoke(
+            [&] { update(degrees.left, -1, +1); },
+            [&] { update(degrees.right, +1, -1); }
+        );
+    } else {
+        update(degrees.left, -1, +1);
+        update(degrees.right, +1, -1);
+    }
+
+    if (touched_terms != nullptr) {
+        for (auto l = left.begin(); l != lit; ++l) {
+            const auto terms = left.terms(*l);
+            touched_terms->insert(touched_terms->end(), terms.begin(), terms.end());
+        }
+        for (auto r = right.begin(); r != rit; ++r) {
+            const auto terms = right.terms(*r);
+            touched_terms->insert(touched_terms->end(), terms.begin(), terms.end());
+        }
+    }
+
+    std::swap_ranges(left.begin(), lit, right.begin());
+    return stats;
+}
+
+template <class Iterator>
+void sortByGain(
+    verticeRange<Iterator>& range, Iterator last, const bisectionConfig& config
+) {
+    if (std::distance(range.begin(), last) >= config.parallel_sort_threshold) {
+        tbb::parallel_sort(range.begin(), last, range.by_gain());
+    } else {
+        std::sort(range.begin(), last, range.by_gain());
+    }
+}
 
-        std::iter_swap(lit, rit);
+template <class Iterator>
+double maxGain(verticeRange<Iterator>& range) {
+    double best = -std::numeric_limits<double>::infinity();
+    for (const auto& vertice: range) {
+        best = std::max(best, range.gain(vertice));
     }
+    return best;
+}
+
+/// Orders both halves so that swap() sees the same positive-gain prefix it
+/// would after a full sort: the candidates are exactly the head of the fully
+/// sorted half, and by_gain() breaks ties by vertex. Only the tail past that
+/// prefix is left unordered with selectionStrategy::candidatesOnly, and since
+/// every level sorts its range by vertex before splitting, orderings match fullSort.
+template <class Iterator>
+void selectSwapCandidates(verticePartition<Iterator>& partition, const bisectionConfig& config) {
+    auto& left = partition.left;
+    auto& right = partition.right;
+    auto left_last = left.end();
+    auto right_last = right.end();
+    if (config.selection == selectionStrategy::candidatesOnly) {
+        // x + y <= 0 for every y of the other half once x <= -max(other half)
+        const double left_bound = -maxGain(right);
+        const double right_bound = -maxGain(left);
+        left_last = std::partition(left.begin(), left.end(), [&](const auto& v) {
+            return left.gain(v) > left_bound;
+        });
+        right_last = std::partition(right.begin(), right.end(), [&](const auto& v) {
+            return right.gain(v) > right_bound;
+        });
+    }
+    tbb::parallel_invoke(
+        [&] { sortByGain(left, left_last, config); },
+        [&] { sortByGain(right, right_last, config); }
+    );
 }
 
 template <class Iterator, class GainF>
@@ -210,36 +633,122 @@ void processPartition(
     verticePartition<Iterator>& partition,
     GainF gainFunction,
     bp::ThreadLocal& thread_local_data,
-    int iterations = 20
+    int iterations = 20,
+    const bisectionConfig& config = {}
 ) {
     auto& left_degree =
         bp::clearOrInit(thread_local_data.left_degrees, partition.left.term_count());
     auto& right_degree =
         bp::clearOrInit(thread_local_data.right_degrees, partition.right.term_count());
-    computeDegrees(partition.left, left_degree);
-    computeDegrees(partition.right, right_degree);
+    if (partition.size() < config.parallel_gain_threshold) {
+        computeDegrees(partition.left, left_degree);
+        computeDegrees(partition.right, right_degree);
+    } else {
+        tbb::parallel_invoke(
+            [&] { computeDegrees(partition.left, left_degree); },
+            [&] { computeDegrees(partition.right, right_degree); }
+        );
+    }
     degreeMapPair degrees{left_degree, right_degree};
 
-    for (int iteration = 0; iteration < iterations; ++iteration) {
-        computeGains(partition, degrees, gainFunction, thread_local_data);
-        tbb::parallel_invoke(
-            [&] {
-                std::sort(
-                    partition.left.begin(),
-                    partition.left.end(),
-                    partition.left.by_gain()
-                );
-            },
-            [&] {
-                std::sort(
-                    partition.right.begin(),
-                    partition.right.end(),
-                    partition.right.by_gain()
-                );
+    bp::localTermSpace space;
+    bp::termPostings postings;
+    std::vector<uint32_t> touched_terms;
+    std::vector<uint32_t> dirty_terms;
+    std::vector<int> term_marks;
+    std::vector<double> left_term_gains;
+    std::vector<double> right_term_gains;
+    degreeMap* slots = nullptr;
+    degreeMap* rows = nullptr;
+    singleInitVector<bool>* stale = nullptr;
+    if (config.incremental_gains || config.partition_term_gains) {
+        slots = &bp::clearOrInit(thread_local_data.term_slots, partition.left.term_count());
+        rows = &bp::clearOrInit(thread_local_data.vertex_rows, partition.left.vertice_count());
+        space = buildLocalTermSpace(partition, *slots, *rows);
+        term_marks.assign(space.size(), -1);
+    }
+    if (config.incremental_gains) {
+        postings = buildPostings(space);
+        stale = &bp::clearOrInit(thread_local_data.stale_vertices, partition.left.vertice_count());
+    }
+
+    auto staleGainFunction = [&](auto& range, auto from_n, auto to_n, const auto& from_lex,
+                                 const auto& to_lex, bp::ThreadLocal& local_data) {
+        computeStaleMoveGains(range, from_n, to_n, from_lex, to_lex, *stale, local_data);
+    };
+    int iteration = 0;
+    auto termTableGainFunction = [&](auto& range, auto, auto, const auto& from_lex, const auto&,
+                                     bp::ThreadLocal&) {
+        const auto& term_gains = &from_lex == &degrees.left ? left_term_gains : right_term_gains;
+        const bool all = stale == nullptr || iteration == 0;
+        for (const auto& d: range) {
+            if (not all && not (*stale)[d]) {
+                continue;
+            }
+            double gain = 0.0;
+            for (const auto& l: space.row((*rows)[d])) {
+                gain += term_gains[l];
             }
+            range.gain(d) = gain;
+        }
+    };
+
+    auto& record = thread_local_data.records.local();
+    while (iteration < iterations) {
+        if (config.partition_term_gains) {
+            computeTermGains(
+                partition,
+                degrees,
+                space,
+                left_term_gains,
+                right_term_gains,
+                thread_local_data,
+                config,
+                iteration == 0 ? nullptr : &dirty_terms
+            );
+            computeGains(partition, degrees, termTableGainFunction, thread_local_data, config);
+        } else if (stale == nullptr || iteration == 0) {
+            computeGains(partition, degrees, gainFunction, thread_local_data, config);
+        } else {
+            computeGains(partition, degrees, staleGainFunction, thread_local_data, config);
+        }
+        selectSwapCandidates(partition, config);
+        touched_terms.clear();
+        const auto stats = swap(
+            partition,
+            degrees,
+            slots != nullptr ? &touched_terms : nullptr,
+            config.parallel_gain_threshold / 2
         );
-        swap(partition, degrees);
+        ++iteration;
+        record.recordSwappedPairs(static_cast<int>(stats.pairs));
+        record.recordCostGain(stats.gain);
+        if (stats.pairs == 0 || stats.gain < config.min_pass_gain) {
+            break;
+        }
+        if (slots == nullptr) {
+            continue;
+        }
+
+        dirty_terms.clear();
+        for (const auto& t: touched_terms) {
+            auto slot = (*slots)[t];
+            if (term_marks[slot] != iteration) {
+                term_marks[slot] = iteration;
+                dirty_terms.push_back(slot);
+            }
+        }
+        if (stale == nullptr) {
+            continue;
+        }
+        stale->clear();
+        for (const auto& slot: dirty_terms) {
+            for (auto p = postings.offsets[slot]; p < postings.offsets[slot + 1]; ++p) {
+                stale->set(postings.vertices[p], true);
+            }
+        }
     }
+    record.recordIterationCount(iteration);
 }
 
 template <class Iterator>
@@ -248,33 +757,111 @@ void recursiveGraphBisection(
     size_t depth,
     int iterations,
     size_t cache_depth,
+    const bisectionConfig& config = {},
     std::shared_ptr<bp::ThreadLocal> thread_local_data = nullptr
+);
+
+/// Bisects @p vertices on a bp::subIndex copy of their terms and writes the
+/// resulting order back in global vertex IDs.
+template <class Iterator>
+void recursiveGraphBisectionOnSubIndex(
+    verticeRange<Iterator> vertices,
+    uint32_t min_term_degree,
+    size_t depth,
+    int iterations,
+    size_t cache_depth,
+    const bisectionConfig& config,
+    const std::shared_ptr<bp::ThreadLocal>& thread_local_data
+) {
+    std::sort(vertices.begin(), vertices.end());
+    auto& slots = bp::clearOrInit(thread_local_data->term_slots, vertices.term_count());
+    // the degree maps are free between processPartition calls
+    auto& counts = bp::clearOrInit(thread_local_data->left_degrees, vertices.term_count());
+    auto sub = extractSubIndex(vertices, slots, &counts, min_term_degree);
+    recursiveGraphBisection(
+        verticeRange(sub.vertices.begin(), sub.vertices.end(), std::cref(sub.fwdidx), std::ref(sub.gains)),
+        depth,
+        iterations,
+        cache_depth,
+        config,
+        thread_local_data
+    );
+    std::transform(sub.vertices.begin(), sub.vertices.end(), vertices.begin(), [&](auto v) {
+        return sub.global_vertices[v];
+    });
+}
+
+template <class Iterator>
+void recursiveGraphBisection(
+    verticeRange<Iterator> vertices,
+    size_t depth,
+    int iterations,
+    size_t cache_depth,
+    const bisectionConfig& config,
+    std::shared_ptr<bp::ThreadLocal> thread_local_data
 ) {
-    if (thread_local_data == nullptr) {
+    const bool is_root = thread_local_data == nullptr;
+    if (is_root) {
         thread_local_data = std::make_shared<bp::ThreadLocal>();
+        if (config.vectorised_gains) {
+            std::vector<uint32_t> term_degrees(vertices.term_count(), 0);
+            uint32_t max_degree = 1;
+            for (const auto& vertice: vertices) {
+                for (const auto& t: vertices.terms(vertice)) {
+                    max_degree = std::max(max_degree, ++term_degrees[t]);
+                }
+            }
+            thread_local_data->gain_table = bp::moveGainTable(max_degree);
+            thread_local_data->move_deltas = bp::moveDeltaKernel();
+        }
     }
     std::sort(vertices.begin(), vertices.end());
+    if (not is_root && not config.child_subindexes && config.local_term_threshold > 0 && vertices.size() <= config.local_term_threshold
+        && static_cast<std::size_t>(vertices.size()) < vertices.vertice_count()) {
+        auto local_config = config;
+        local_config.local_term_threshold = 0;
+        recursiveGraphBisectionOnSubIndex(
+            vertices, 1, depth, iterations, cache_depth, local_config, thread_local_data
+        );
+        return;
+    }
     auto partition = vertices.split();
+    // processPartition holds references into this thread's ThreadLocal maps, so a
+    // thread waiting on its nested parallel work must not pick up a sibling partition.
+    tbb::this_task_arena::isolate([&] {
+        if (config.vectorised_gains) {
+            processPartition(partition, computeMoveGainsVectorised<Iterator>, *thread_local_data, iterations, config);
+        } else if (cache_depth >= 1) {
+            processPartition(partition, computeMoveGainsCaching<true, Iterator>, *thread_local_data, iterations, config);
+        } else {
+            processPartition(partition, computeMoveGainsCaching<false, Iterator>, *thread_local_data, iterations, config);
+        }
+    });
     if (cache_depth >= 1) {
-        processPartition(partition, computeMoveGainsCaching<true, Iterator>, *thread_local_data, iterations);
         --cache_depth;
-    } else {
-        processPartition(partition, computeMoveGainsCaching<false, Iterator>, *thread_local_data, iterations);
     }
 
     if (depth > 1 && vertices.size() > 2) {
-        tbb::parallel_invoke(
-            [&, thread_local_data] {
-                recursiveGraphBisection(partition.left, depth - 1, iterations, cache_depth, thread_local_data);
-            },
-            [&, thread_local_data] {
-                recursiveGraphBisection(partition.right, depth - 1, iterations, cache_depth, thread_local_data);
+        auto recurse = [&, thread_local_data](auto& half) {
+            if (config.child_subindexes) {
+                recursiveGraphBisectionOnSubIndex(
+                    half, 2, depth - 1, iterations, cache_depth, config, thread_local_data
+                );
+            } else {
+                recursiveGraphBisection(half, depth - 1, iterations, cache_depth, config, thread_local_data);
             }
-        );
+        };
+        tbb::parallel_invoke([&] { recurse(partition.left); }, [&] { recurse(partition.right); });
     } else {
         std::sort(partition.left.begin(), partition.left.end());
         std::sort(partition.right.begin(), partition.right.end());
     }
+
+    if (is_root && config.record != nullptr) {
+        for (const auto& local_record: thread_local_data->records) {
+            config.record->merge(local_record);
+        }
+    }
 }
 
 }  // namespace pisa
\ No newline at end of file
@@ -1,113 +1,235 @@
 #pragma once
 
-#include <map>
 #include <vector>
-#include <cstdlib>
+#include <cstdint>
+#include <numeric>
+#include <tuple>
 #include <assert.h>
 #include <algorithm>
 #include <core/util.hh>
+#include <util/sparseDemand.hh>
+
+// Tree grown one vertex at a time, each new vertex hanging under an inserted one. Binary
+// lifting answers tree distances between inserted vertices in O(log n) and stays valid as
+// vertices are appended, so no n x n distance table is kept.
+class GrowingTree_t {
+public:
+    explicit GrowingTree_t (int nVertices)
+        : n_(nVertices), levels_(1), depth_(nVertices, 0) {
+        while ((1 << levels_) < nVertices)
+            levels_++;
+        up_.assign(static_cast<size_t>(levels_) * n_, 0);
+    }
+
+    // parent -1 makes vIdx the root
+    void insert (int vIdx, int parent) {
+        depth_[vIdx] = parent == -1 ? 0 : depth_[parent] + 1;
+        ancestor(0, vIdx) = parent == -1 ? vIdx : parent;
+        for (int k = 1; k < levels_; k++)
+            ancestor(k, vIdx) = ancestor(k - 1, ancestor(k - 1, vIdx));
+    }
+
+    int depth (int vIdx) const { return depth_[vIdx]; }
+
+    int lca (int a, int b) const {
+        if (depth_[a] < depth_[b])
+            std::swap(a, b);
+        for (int k = levels_ - 1; k >= 0; k--)
+            if (depth_[a] - (1 << k) >= depth_[b])
+                a = ancestor(k, a);
+        if (a == b)
+            return a;
+
+        for (int k = levels_ - 1; k >= 0; k--)
+            if (ancestor(k, a) != ancestor(k, b)) {
+                a = ancestor(k, a);
+                b = ancestor(k, b);
+            }
+        return ancestor(0, a);
+    }
 
+    int distance (int a, int b) const {
+        return depth_[a] + depth_[b] - 2 * depth_[lca(a, b)];
+    }
+
+private:
+    int& ancestor (int k, int vIdx) { return up_[static_cast<size_t>(k) * n_ + vIdx]; }
+    int ancestor (int k, int vIdx) const { return up_[static_cast<size_t>(k) * n_ + vIdx]; }
 
-std::vector<int> rank;
+    int n_, levels_;
+    std::vector<int> depth_;
+    std::vector<int> up_;  // up_[k * n + v]: 2^k-th ancestor of v, the root being its own
+};
 
-class CompareRank {
-    public:
+// Inserted vertices that can still take a child, in a flat array with O(1) removal.
+class LeafSet_t {
+public:
+    explicit LeafSet_t (int nVertices) : slot_(nVertices, -1), freeChildren_(nVertices, 0) {}
 
-    bool operator() (const std::pair<int, int> x, const std::pair<int, int> y) const {
-        return rank[x.first] > rank[y.first];
+    bool empty () const { return leafes_.empty(); }
+    const std::vector<int>& vertices () const { return leafes_; }
 
+    void add (int vIdx) {
+        freeChildren_[vIdx] = 2;
+        slot_[vIdx] = leafes_.size();
+        leafes_.push_back(vIdx);
     }
+
+    // vIdx took a child; drops it once both children are taken
+    void takeChild (int vIdx) {
+        if (--freeChildren_[vIdx] > 0)
+            return;
+
+        int last = leafes_.back();
+        leafes_[slot_[vIdx]] = last;
+        slot_[last] = slot_[vIdx];
+        leafes_.pop_back();
+        slot_[vIdx] = -1;
+    }
+
+private:
+    std::vector<int> leafes_;
+    std::vector<int> slot_;
+    std::vector<int> freeChildren_;
 };
 
-void insertVertexGreedily (
-    int vIdx, double& totalCost, std::map<int, int>& leafes, std::vector<std::vector<int>>& distances,
-    const std::vector<std::vector<double>>& demandMatrix, std::vector<int>& pred, std::vector<int>& rank
+// Demand of one vertex with one neighbour, in either direction.
+struct GreedyNeighbour_t {
+    int vIdx;
+    double demand;
+};
+
+// Hangs vIdx under the leaf that adds the least demand-weighted distance to the vertices
+// already inserted, the smallest leaf on ties. The first vertex becomes the root.
+inline void insertVertexGreedily (
+    int vIdx, double& totalCost, LeafSet_t& leafes, GrowingTree_t& tree,
+    const std::vector<std::vector<GreedyNeighbour_t>>& neighbours, std::vector<int>& pred
 ) {
     if (pred[vIdx] != INF)
         return;
 
-    else if (leafes.size() == 0) {
-        rank[vIdx] = 0;
+    else if (leafes.empty()) {
         pred[vIdx] = -1;
-        leafes[vIdx] = 2;
+        tree.insert(vIdx, -1);
+        leafes.add(vIdx);
 
         return;
 
     }
 
+    std::vector<GreedyNeighbour_t> inserted;
+    for (const auto& nbr: neighbours[vIdx])
+        if (pred[nbr.vIdx] != INF)
+            inserted.push_back(nbr);
+
     double pMin = LINF;
-    double pIdx = -1;
+    int pIdx = -1;
 
-    for (const auto [leaf, degree]: leafes) {
+    for (int leaf: leafes.vertices()) {
         double cCost = 0;
 
-        for (int dst = 0; dst < demandMatrix[vIdx].size(); dst++) {
-            if (pred[dst] == INF)
-                continue;
-
-            cCost += (distances[leaf][dst] + 1) * demandMatrix[vIdx][dst];
-            cCost += (distances[leaf][dst] + 1) * demandMatrix[dst][vIdx];
-
-        }
+        for (const auto& nbr: inserted)
+            cCost += (tree.distance(leaf, nbr.vIdx) + 1) * nbr.demand;
 
-        if (cCost < pMin) {
+        if (cCost < pMin || (cCost == pMin && leaf < pIdx)) {
             pMin = cCost;
             pIdx = leaf;
         }
     }
 
-    auto it = leafes.find(pIdx);
-    if (it->second == 1) {
-        leafes.erase(it);
-
-    } else {
-        it->second--;
-
-    }
+    leafes.takeChild(pIdx);
 
     totalCost += pMin;
-    leafes[vIdx] = 2;
     pred[vIdx] = pIdx;
-    rank[vIdx] = rank[pIdx] + 1;
-    for (int dst = 0; dst < demandMatrix[vIdx].size(); dst++) {
-        if (pred[dst] == INF || vIdx == dst)
-            continue;
-
-        distances[vIdx][dst] = distances[pIdx][dst] + 1;
-        distances[dst][vIdx] = distances[dst][pIdx] + 1;
-    }
+    tree.insert(vIdx, pIdx);
+    leafes.add(vIdx);
 }
 
-double greedyConstructor (
-    int nVertices, const std::vector<std::vector<double>>& demandMatrix
+// Greedy tree over the positions of `vertices` (vertices[pos] = vertex): positions are
+// inserted by decreasing demand of the non-zero requests, ties by (src, dst), then those
+// without demand in ascending order. O(E log E + n * leaves * deg * log n).
+inline double greedyConstructor (
+    const std::vector<uint32_t>& vertices, const pisa::sparseDemand& demand
 ) {
-    std::vector<std::vector<int>> distances(nVertices, std::vector<int>(nVertices, 0));
-    std::vector<int> pred(nVertices, INF);
-    rank = std::vector<int>(nVertices, INF);
-    std::map<int, int> leafes;
-    std::set<int> insertedVertices;
-
-    double totalCost = 0;
-
-    std::vector<std::pair<double, std::pair<int, int>>> queries;
+    int nVertices = vertices.size();
+    std::vector<int> position(nVertices);
+    for (int pos = 0; pos < nVertices; pos++)
+        position[vertices[pos]] = pos;
+
+    struct Query_t {
+        double demand;
+        int src, dst;
+    };
+    // heap order: the largest demand on top, then the smallest (src, dst)
+    auto later = [] (const Query_t& a, const Query_t& b) {
+        if (a.demand != b.demand)
+            return a.demand < b.demand;
+        return std::make_pair(a.src, a.dst) > std::make_pair(b.src, b.dst);
+    };
+
+    struct Arc_t {
+        int from, to, direction;  // direction 0: from -> to, 1: to -> from
+        double demand;
+    };
+
+    std::vector<Query_t> queries;
+    std::vector<Arc_t> arcs;
+    queries.reserve(demand.numEntries());
+    arcs.reserve(2 * demand.numEntries());
     for (int src = 0; src < nVertices; src++) {
-        for (int dst = 0; dst < nVertices; dst++) {
-            queries.push_back({ -demandMatrix[src][dst], { src, dst } });
+        for (const auto& e: demand.row(src)) {
+            int s = position[src], d = position[e.dst];
+            if (e.weight == 0)
+                continue;
 
+            queries.push_back({ e.weight, s, d });
+            if (s != d) {
+                arcs.push_back({ s, d, 0, e.weight });
+                arcs.push_back({ d, s, 1, e.weight });
+            }
         }
     }
-    std::sort(queries.begin(), queries.end());
 
-    for (const auto& query : queries) {
-        auto [src, dst] = query.second;
-        insertVertexGreedily(src, totalCost, leafes, distances, demandMatrix, pred, rank);
-        insertVertexGreedily(dst, totalCost, leafes, distances, demandMatrix, pred, rank);
+    // both directions of every pair, by neighbour and src -> dst first, so insertion costs
+    // add up in the same order as a scan of the dense row and column would
+    std::sort(arcs.begin(), arcs.end(), [] (const Arc_t& a, const Arc_t& b) {
+        return std::tie(a.from, a.to, a.direction) < std::tie(b.from, b.to, b.direction);
+    });
+    std::vector<std::vector<GreedyNeighbour_t>> neighbours(nVertices);
+    for (const auto& arc: arcs)
+        neighbours[arc.from].push_back({ arc.to, arc.demand });
 
-        insertedVertices.insert(src);
-        insertedVertices.insert(dst);
-        if (insertedVertices.size() == nVertices)
-            break;
+    std::vector<int> pred(nVertices, INF);
+    GrowingTree_t tree(nVertices);
+    LeafSet_t leafes(nVertices);
+    int nInserted = 0;
+    double totalCost = 0;
+
+    auto insert = [&] (int vIdx) {
+        if (pred[vIdx] != INF)
+            return;
+        insertVertexGreedily(vIdx, totalCost, leafes, tree, neighbours, pred);
+        nInserted++;
+    };
+
+    // popped lazily: the remaining queries are never ordered once every vertex is placed
+    std::make_heap(queries.begin(), queries.end(), later);
+    for (auto end = queries.end(); end != queries.begin() && nInserted < nVertices; --end) {
+        std::pop_heap(queries.begin(), end, later);
+        insert(end[-1].src);
+        insert(end[-1].dst);
     }
 
+    for (int vIdx = 0; vIdx < nVertices; vIdx++)
+        insert(vIdx);
+
     return totalCost;
 }
+
+inline double greedyConstructor (
+    int nVertices, const std::vector<std::vector<double>>& demandMatrix
+) {
+    std::vector<uint32_t> vertices(nVertices);
+    std::iota(vertices.begin(), vertices.end(), 0);
+    return greedyConstructor(vertices, pisa::sparseDemand::fromDense(demandMatrix));
+}
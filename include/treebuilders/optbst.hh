@@ -1,41 +1,108 @@
 #pragma once
 
 #include <core/util.hh>
+#include <util/sparseDemand.hh>
 #include <assert.h>
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <tbb/parallel_for.h>
 
 struct IntervalRoot_t{
     double cost;
     int root;
 };
 
-std::vector<std::vector<double>> buildAggregateDemand (
-    int nVertices, const std::vector<std::vector<double>>& demandMatrix
-) {
-    std::vector<std::vector<double>> nodeWeight(nVertices, std::vector<double>(nVertices, 0));
-    std::vector<std::vector<double>> aggDemand(nVertices, std::vector<double>(nVertices, 0));
+// How the root of each interval is searched for.
+//  EXHAUSTIVE tries every position of the interval, O(n^3) overall, and is exact.
+//  KNUTH only tries [root(l, r - 1), root(l + 1, r)], O(n^2) overall. Knuth's bound
+//  needs interval weights with the quadrangle inequality, and interval cuts are
+//  submodular instead, so this is a heuristic upper bound on the optimum (2-12% above
+//  it on the tor traces), meant for orderings too large for the exact DP.
+enum class RootSearch_t { EXHAUSTIVE, KNUTH };
+
+// Demand crossing the boundary of every position interval [l, r], i.e. of every request
+// with one end inside and one outside. A single (n + 1)^2 table of 2-D prefix sums over
+// the symmetrised demand s = d + d^T answers each interval in O(1):
+//   cut(l, r) = s(l..r, 0..n-1) - s(l..r, l..r)
+class IntervalCut_t {
+public:
+    explicit IntervalCut_t (const std::vector<std::vector<double>>& demandMatrix)
+        : n_(demandMatrix.size()), prefix_((n_ + 1) * (n_ + 1), 0.0) {
+        for (int i = 0; i < n_; i++)
+            for (int j = 0; j < n_; j++)
+                cell(i + 1, j + 1) += demandMatrix[i][j] + demandMatrix[j][i];
+        accumulate();
+    }
 
-    for (int i = 0; i < nVertices; i++) {
-        for (int j = 0; j < nVertices; j++) {
-            nodeWeight[i][j] = (
-                demandMatrix[i][j] + demandMatrix[j][i] + (j == 0 ? 0 : nodeWeight[i][j - 1])
-            );
+    // Cuts of the positions of `vertices` (vertices[pos] = vertex), straight from the
+    // sparse demand: no reordered n x n demand matrix is built.
+    IntervalCut_t (const std::vector<uint32_t>& vertices, const pisa::sparseDemand& demand)
+        : n_(vertices.size()), prefix_((n_ + 1) * (n_ + 1), 0.0) {
+        std::vector<uint32_t> position(n_);
+        for (int pos = 0; pos < n_; pos++)
+            position[vertices[pos]] = pos;
+
+        for (int src = 0; src < n_; src++) {
+            for (const auto& e: demand.row(src)) {
+                cell(position[src] + 1, position[e.dst] + 1) += e.weight;
+                cell(position[e.dst] + 1, position[src] + 1) += e.weight;
+            }
         }
+        accumulate();
+    }
+
+    int size () const { return n_; }
+
+    // 0 for the empty interval (lIdx > rIdx)
+    double operator() (int lIdx, int rIdx) const {
+        if (lIdx > rIdx)
+            return 0;
+        double rows = at(rIdx + 1, n_) - at(lIdx, n_);
+        double inner = at(rIdx + 1, rIdx + 1) - at(lIdx, rIdx + 1) - at(rIdx + 1, lIdx) + at(lIdx, lIdx);
+        return rows - inner;
     }
 
-    for (int i = 0; i < nVertices; i++) {
-        for (int j = 0; j < nVertices; j++) {
-            for (int k = i; k <= j; k++) {
-                aggDemand[i][j] += (
-                    nodeWeight[k][nVertices - 1] - nodeWeight[k][j] + (i == 0 ? 0 : nodeWeight[k][i - 1])
-                );
+private:
+    double& cell (int i, int j) { return prefix_[static_cast<size_t>(i) * (n_ + 1) + j]; }
+    double at (int i, int j) const { return prefix_[static_cast<size_t>(i) * (n_ + 1) + j]; }
+
+    // turns the scattered cells into prefix(i, j) = s(0..i-1, 0..j-1)
+    void accumulate () {
+        for (int i = 1; i <= n_; i++) {
+            double rowSum = 0;
+            for (int j = 1; j <= n_; j++) {
+                rowSum += cell(i, j);
+                cell(i, j) = at(i - 1, j) + rowSum;
             }
         }
     }
 
+    int n_;
+    std::vector<double> prefix_;
+};
+
+// O(n^2) via IntervalCut_t; kept for callers that want the whole aggregate matrix.
+inline std::vector<std::vector<double>> buildAggregateDemand (
+    int nVertices, const std::vector<std::vector<double>>& demandMatrix
+) {
+    IntervalCut_t cut(demandMatrix);
+    std::vector<std::vector<double>> aggDemand(nVertices, std::vector<double>(nVertices, 0));
+
+    for (int i = 0; i < nVertices; i++)
+        for (int j = i; j < nVertices; j++)
+            aggDemand[i][j] = cut(i, j);
+
     return aggDemand;
 }
 
-std::vector<std::vector<double>> buildAggregateDemandN4 (
+inline std::vector<std::vector<double>> buildAggregateDemandN4 (
     int nVertices, const std::vector<std::vector<double>>& demandMatrix
 ) {
     std::vector<std::vector<double>> aggDemand(nVertices, std::vector<double>(nVertices, 0));
@@ -56,75 +123,238 @@ std::vector<std::vector<double>> buildAggregateDemandN4 (
     return aggDemand;
 }
 
-IntervalRoot_t buildOptimalBST (
-    int nVertices, const std::vector<std::vector<double>>& aggr,
-    std::vector<std::vector<IntervalRoot_t>>& intervals
-) {
-    for (int vIdx = 0; vIdx < nVertices; vIdx++)
-        intervals[vIdx][vIdx] = IntervalRoot_t{ 0, vIdx };
+// DP state of every interval [l, r] of n positions, in flat triangles instead of n x n
+// matrices. What a subtree adds under its parent, cost(l, r) + cut(l, r), is stored both
+// by row (fixed l) and by column (fixed r), with a zero slot for the empty interval at
+// each end, so the root scan of [l, r] reads its two operands as contiguous runs:
+//   left[x - l] = subtree(l, x - 1) and right[x - l] = subtree(x + 1, r)
+class IntervalTable_t {
+public:
+    explicit IntervalTable_t (int n)
+        : n_(n),
+          byRow_(static_cast<size_t>(n) * (n + 3) / 2 + 1, 0.0),
+          byCol_(static_cast<size_t>(n) * (n + 3) / 2 + 1, 0.0),
+          roots_(static_cast<size_t>(n) * (n + 1) / 2, -1) {}
+
+    int size () const { return n_; }
 
-    for (int delta = 1; delta < nVertices; delta++) {
-        for (int lIdx = 0; lIdx < nVertices; lIdx++) {
-            int rIdx = lIdx + delta;
-            if (rIdx >= nVertices)
-                continue;
+    // row l holds r = l - 1 .. n - 1
+    double* rowFrom (int lIdx) { return &byRow_[rowStart(lIdx)]; }
+    // column r holds l = 0 .. r + 1
+    double* colFrom (int lIdx, int rIdx) { return &byCol_[colStart(rIdx) + lIdx]; }
 
-            for (int x = lIdx; x <= rIdx; x++) {
-                double cost = 0;
-                if (x != rIdx)
-                    cost += intervals[x + 1][rIdx].cost + aggr[x+1][rIdx];
+    void setSubtree (int lIdx, int rIdx, double cost) {
+        byRow_[rowStart(lIdx) + (rIdx - lIdx + 1)] = cost;
+        byCol_[colStart(rIdx) + lIdx] = cost;
+    }
 
-                if (x != lIdx)
-                    cost += intervals[lIdx][x-1].cost + aggr[lIdx][x-1];
+    int& root (int lIdx, int rIdx) {
+        return roots_[static_cast<size_t>(lIdx) * n_ - static_cast<size_t>(lIdx) * (lIdx - 1) / 2 + (rIdx - lIdx)];
+    }
 
-                if (cost < intervals[lIdx][rIdx].cost) {
-                    intervals[lIdx][rIdx] = { cost, x };
-                }
+private:
+    size_t rowStart (int lIdx) const {
+        return static_cast<size_t>(lIdx) * (n_ + 1) - static_cast<size_t>(lIdx) * (lIdx - 1) / 2;
+    }
+    size_t colStart (int rIdx) const { return static_cast<size_t>(rIdx) * (rIdx + 3) / 2; }
 
-            }
-        }
+    int n_;
+    std::vector<double> byRow_, byCol_;
+    std::vector<int> roots_;
+};
+
+// Edge of the square tiles buildOptimalBST hands to each task; 64 rows of a tile and the
+// column runs they scan stay in L2 while every r of the tile is solved.
+constexpr int obstTileSize = 64;
+
+// Solves [lIdx, rIdx] from its already solved sub-intervals [l, x - 1] and [x + 1, r].
+inline IntervalRoot_t solveInterval (
+    const IntervalCut_t& cut, IntervalTable_t& table, RootSearch_t search, int lIdx, int rIdx
+) {
+    int lo = lIdx, hi = rIdx;
+    if (search == RootSearch_t::KNUTH && lIdx < rIdx) {
+        lo = table.root(lIdx, rIdx - 1);
+        hi = table.root(lIdx + 1, rIdx);
     }
 
-    return intervals[0][nVertices - 1];
+    const double* left = table.rowFrom(lIdx);           // left[x - l]: [l, x - 1]
+    const double* right = table.colFrom(lIdx + 1, rIdx); // right[x - l]: [x + 1, r]
+    IntervalRoot_t best = { std::numeric_limits<double>::infinity(), -1 };
+    for (int x = lo; x <= hi; x++) {
+        double cost = left[x - lIdx] + right[x - lIdx];
+        if (cost < best.cost)
+            best = { cost, x };
+    }
+
+    table.root(lIdx, rIdx) = best.root;
+    table.setSubtree(lIdx, rIdx, best.cost + cut(lIdx, rIdx));
+    return best;
 }
 
-double optimalBST (
-    int nVertices, const std::vector<std::vector<double>>& demandMatrix,
-    bool verbose = false
+// Fills `table` and returns the cost and root of [0, n - 1].
+//
+// [l, r] only reads intervals of its own row l with a smaller r and of its own column r
+// with a larger l. Cut into tiles of obstTileSize rows l by obstTileSize columns r, tile
+// (I, J) therefore only reads tiles (I, J' < J) and (I' > I, J), all of them on earlier
+// tile diagonals J - I: the tiles of one diagonal are independent and run in parallel,
+// one diagonal after the other. Inside a tile r ascends and l descends. Every interval
+// sees the same operands in the same order as in a serial sweep, so the result does not
+// depend on the number of threads.
+inline IntervalRoot_t buildOptimalBST (
+    const IntervalCut_t& cut, IntervalTable_t& table, RootSearch_t search = RootSearch_t::EXHAUSTIVE
 ) {
-    std::vector<std::vector<IntervalRoot_t>> intervals(
-        nVertices, std::vector<IntervalRoot_t>(nVertices, IntervalRoot_t{ INF, -1 }
-    ));
-    std::vector<std::vector<double>> agg = buildAggregateDemand(nVertices, demandMatrix);
-    std::vector<int> pred(nVertices);
-    std::queue<std::pair<int, std::pair<int, int>>> q;
+    int nVertices = cut.size();
+    if (nVertices == 0)
+        return { 0, -1 };
 
-    IntervalRoot_t root = buildOptimalBST(nVertices, agg, intervals);
+    int nTiles = (nVertices + obstTileSize - 1) / obstTileSize;
+    auto solveTile = [&] (int tileRow, int tileCol) {
+        int lBegin = tileRow * obstTileSize, lEnd = std::min(lBegin + obstTileSize, nVertices);
+        int rBegin = tileCol * obstTileSize, rEnd = std::min(rBegin + obstTileSize, nVertices);
+        for (int rIdx = rBegin; rIdx < rEnd; rIdx++)
+            for (int lIdx = std::min(rIdx, lEnd - 1); lIdx >= lBegin; lIdx--)
+                solveInterval(cut, table, search, lIdx, rIdx);
+    };
 
-    if (verbose) {
+    for (int diagonal = 0; diagonal < nTiles; diagonal++) {
+        tbb::parallel_for(0, nTiles - diagonal, [&] (int tileRow) {
+            solveTile(tileRow, tileRow + diagonal);
+        });
+    }
+
+    return solveInterval(cut, table, search, 0, nVertices - 1);
+}
+
+// pred[pos] = position of the parent of pos in the tree, -1 for the root
+inline std::vector<int> obstPredecessors (IntervalTable_t& table) {
+    int nVertices = table.size();
+    std::vector<int> pred(nVertices);
+    std::queue<std::pair<int, std::pair<int, int>>> q;
+    if (nVertices > 0)
         q.push({ -1, { 0, nVertices - 1 } });
 
-        while (!q.empty()) {
-            auto [ pIdx, inter ] = q.front(); q.pop();
-            IntervalRoot_t intResp = intervals[inter.first][inter.second];
+    while (!q.empty()) {
+        auto [ pIdx, inter ] = q.front(); q.pop();
+        int root = table.root(inter.first, inter.second);
 
-            pred[intResp.root] = pIdx;
+        pred[root] = pIdx;
 
-            if (intResp.root != inter.first) {
-                q.push({ intResp.root, { inter.first, intResp.root - 1 } });
+        if (root != inter.first) {
+            q.push({ root, { inter.first, root - 1 } });
 
-            }
+        }
 
-            if (intResp.root != inter.second) {
-                q.push({ intResp.root, { intResp.root + 1, inter.second }});
+        if (root != inter.second) {
+            q.push({ root, { root + 1, inter.second }});
 
-            }
         }
+    }
 
-        for (int vIdx = 0; vIdx < nVertices; vIdx++) {
-            std::cout << pred[vIdx] << " ";
+    return pred;
+}
+
+// The tree optimalBST builds over the positions of an ordering.
+struct ObstTree_t {
+    double cost;
+    std::vector<int> predecessors;  // parent position of every position, -1 for the root
+};
+
+inline ObstTree_t optimalBSTTree (
+    const IntervalCut_t& cut, RootSearch_t search = RootSearch_t::EXHAUSTIVE
+) {
+    if (cut.size() == 0)
+        return { 0, {} };
+
+    IntervalTable_t table(cut.size());
+    IntervalRoot_t root = buildOptimalBST(cut, table, search);
+    return { root.cost, obstPredecessors(table) };
+}
+
+inline ObstTree_t optimalBSTTree (
+    const std::vector<uint32_t>& vertices, const pisa::sparseDemand& demand,
+    RootSearch_t search = RootSearch_t::EXHAUSTIVE
+) {
+    return optimalBSTTree(IntervalCut_t(vertices, demand), search);
+}
+
+inline double optimalBST (
+    const IntervalCut_t& cut, bool verbose = false, RootSearch_t search = RootSearch_t::EXHAUSTIVE
+) {
+    ObstTree_t tree = optimalBSTTree(cut, search);
+
+    if (verbose) {
+        for (int pIdx: tree.predecessors) {
+            std::cout << pIdx << " ";
         }
     }
 
-    return root.cost;
+    return tree.cost;
+}
+
+inline double optimalBST (
+    int nVertices, const std::vector<std::vector<double>>& demandMatrix,
+    bool verbose = false, RootSearch_t search = RootSearch_t::EXHAUSTIVE
+) {
+    assert(nVertices == static_cast<int>(demandMatrix.size()));
+    return optimalBST(IntervalCut_t(demandMatrix), verbose, search);
+}
+
+// OBST over the positions of `vertices`, reading the sparse demand directly.
+inline double optimalBST (
+    const std::vector<uint32_t>& vertices, const pisa::sparseDemand& demand,
+    RootSearch_t search = RootSearch_t::EXHAUSTIVE
+) {
+    return optimalBST(IntervalCut_t(vertices, demand), false, search);
+}
+
+// Tree file: "<n> <cost>", then one "<vertex> <parent vertex>" line per position of the
+// ordering, -1 as the parent of the root. It holds both the ordering and the topology, so
+// the tree can be deployed, or priced with pisa::searchTreeCost, without the DP.
+inline void writeObstTree (
+    const std::string& path, const std::vector<uint32_t>& vertices, const ObstTree_t& tree
+) {
+    std::ofstream file(path);
+    if (!file.is_open())
+        throw std::runtime_error("Could not open file: " + path);
+
+    file << std::setprecision(17) << vertices.size() << " " << tree.cost << "\n";
+    for (size_t pos = 0; pos < vertices.size(); pos++) {
+        int parent = tree.predecessors[pos];
+        file << vertices[pos] << " " << (parent == -1 ? -1 : static_cast<int64_t>(vertices[parent])) << "\n";
+    }
+}
+
+// Reads a tree file back into the ordering it was built on and its tree.
+inline ObstTree_t readObstTree (const std::string& path, std::vector<uint32_t>& vertices) {
+    std::ifstream file(path);
+    if (!file.is_open())
+        throw std::runtime_error("Could not open file: " + path);
+
+    size_t nVertices;
+    ObstTree_t tree;
+    if (!(file >> nVertices >> tree.cost))
+        throw std::runtime_error("Invalid tree file header: " + path);
+
+    std::vector<int64_t> parents(nVertices);
+    vertices.resize(nVertices);
+    for (size_t pos = 0; pos < nVertices; pos++) {
+        if (!(file >> vertices[pos] >> parents[pos]))
+            throw std::runtime_error("Not enough lines in tree file: " + path);
+    }
+
+    std::vector<int> position(nVertices, -1);
+    for (size_t pos = 0; pos < nVertices; pos++) {
+        if (vertices[pos] >= nVertices || position[vertices[pos]] != -1)
+            throw std::runtime_error("Tree file does not hold an ordering: " + path);
+        position[vertices[pos]] = pos;
+    }
+
+    tree.predecessors.resize(nVertices);
+    for (size_t pos = 0; pos < nVertices; pos++) {
+        if (parents[pos] < -1 || parents[pos] >= static_cast<int64_t>(nVertices))
+            throw std::runtime_error("Invalid parent in tree file: " + path);
+        tree.predecessors[pos] = parents[pos] == -1 ? -1 : position[parents[pos]];
+    }
+
+    return tree;
 }
@@ -0,0 +1,339 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "util/forwardIndex.hh"
+#include "util/forwardIndexFactory.hh"
+#include "util/sparseDemand.hh"
+#include "util/traceParser.hh"
+
+namespace pisa {
+
+/// A loaded demand plus whichever forward indexes came prebuilt with it.
+struct datasetBundle {
+    sparseDemand demand;
+    std::optional<forwardIndex> mlogaIndex;
+    std::optional<forwardIndex> logGapIndex;
+
+    datasetBundle() = default;
+    datasetBundle(sparseDemand d) : demand(std::move(d)) {}
+};
+
+/// Binary dataset cache, in native byte order:
+///
+///   header | demand offsets (n + 1 x u32) | demand entries (nnz x demandEntry)
+///          | [mloga offsets | mloga terms] | [loggap offsets | loggap terms]
+///
+/// Every array starts on a 64-byte boundary, so a mapped file is used in place:
+/// loading is one mmap and the pages are shared with every other process reading it.
+namespace datasetCache {
+
+constexpr char magic[8] = {'P', 'I', 'S', 'A', 'D', 'E', 'M', 'D'};
+constexpr uint32_t version = 2;
+constexpr std::size_t alignment = 64;
+constexpr const char* extension = ".bpds";
+
+/// Location of one stored forward index; all zero when it is absent.
+struct indexSection {
+    uint64_t termCount;
+    uint64_t documentCount;
+    uint64_t numTerms;
+    uint64_t offsetsPos;
+    uint64_t termsPos;
+};
+
+struct header {
+    char magic[8];
+    uint32_t version;
+    uint32_t entrySize;
+    uint64_t fileSize;
+    uint32_t sourceFormat;  ///< textFormat of the text file the cache was built from
+    uint32_t reserved;
+    uint64_t sourceSize;    ///< byte size of that text file
+    uint64_t numVertices;
+    uint64_t numEntries;
+    uint64_t offsetsPos;
+    uint64_t entriesPos;
+    indexSection mloga;
+    indexSection logGap;
+};
+
+static_assert(sizeof(demandEntry) == 16 && offsetof(demandEntry, weight) == 8,
+              "the cache stores demandEntry as {u32 dst, 4 zero bytes, f64 weight}");
+
+inline uint64_t alignUp(uint64_t pos) { return (pos + alignment - 1) / alignment * alignment; }
+
+/// Read-only private mapping of a whole file, unmapped with the last owner.
+class mappedFile {
+  public:
+    explicit mappedFile(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Could not open dataset cache: " + path);
+        }
+        struct stat st {};
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Could not stat dataset cache: " + path);
+        }
+        m_size = static_cast<std::size_t>(st.st_size);
+        if (m_size > 0) {
+            m_data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        ::close(fd);
+        if (m_data == MAP_FAILED) {
+            m_data = nullptr;
+            throw std::runtime_error("Could not map dataset cache: " + path);
+        }
+    }
+
+    mappedFile(const mappedFile&) = delete;
+    mappedFile& operator=(const mappedFile&) = delete;
+
+    ~mappedFile() {
+        if (m_data != nullptr) {
+            ::munmap(m_data, m_size);
+        }
+    }
+
+    [[nodiscard]] const char* data() const { return static_cast<const char*>(m_data); }
+    [[nodiscard]] std::size_t size() const { return m_size; }
+
+  private:
+    void* m_data = nullptr;
+    std::size_t m_size = 0;
+};
+
+/// @p count elements of T at byte @p pos of the mapping, bounds- and alignment-checked.
+template <typename T>
+sharedArray<T> viewArray(
+    const std::shared_ptr<const mappedFile>& file, uint64_t pos, uint64_t count, const std::string& path
+) {
+    if (pos % alignment != 0 || pos > file->size() || count > (file->size() - pos) / sizeof(T)) {
+        throw std::runtime_error("Invalid dataset cache " + path + ": array out of bounds");
+    }
+    return sharedArray<T>(file, reinterpret_cast<const T*>(file->data() + pos), count);
+}
+
+/// Reads the header of @p path; false if it is missing or not a cache.
+inline bool readHeader(const std::string& path, header& h) {
+    std::ifstream file(path, std::ios::binary);
+    return file.read(reinterpret_cast<char*>(&h), sizeof(h))
+        && std::memcmp(h.magic, magic, sizeof(magic)) == 0;
+}
+
+} // namespace datasetCache
+
+/// True if @p path exists and starts with the cache magic.
+inline bool isDatasetCache(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    char head[sizeof(datasetCache::magic)] = {};
+    return file.read(head, sizeof(head)) && std::memcmp(head, datasetCache::magic, sizeof(head)) == 0;
+}
+
+/// Writes @p bundle (and whichever indexes it holds) to @p path, recording the format
+/// and byte size of the text file it was parsed from. The file is written next to its
+/// destination and renamed into place, so concurrent readers never see a partial cache.
+inline void writeDatasetCache(
+    const std::string& path, const datasetBundle& bundle,
+    textFormat sourceFormat = textFormat::requests, uint64_t sourceSize = 0
+) {
+    using namespace datasetCache;
+    const sparseDemand& demand = bundle.demand;
+
+    header h{};
+    std::memcpy(h.magic, magic, sizeof(magic));
+    h.version = version;
+    h.entrySize = sizeof(demandEntry);
+    h.sourceFormat = static_cast<uint32_t>(sourceFormat);
+    h.sourceSize = sourceSize;
+    h.numVertices = demand.numVertices();
+    h.numEntries = demand.numEntries();
+    h.offsetsPos = alignUp(sizeof(header));
+    h.entriesPos = alignUp(h.offsetsPos + demand.offsets().size() * sizeof(uint32_t));
+    uint64_t end = h.entriesPos + demand.numEntries() * sizeof(demandEntry);
+
+    auto place = [&end](const std::optional<forwardIndex>& index, indexSection& section) {
+        if (!index) {
+            return;
+        }
+        section.termCount = index->termCount();
+        section.documentCount = index->documentCount();
+        section.numTerms = index->flatTerms().size();
+        section.offsetsPos = alignUp(end);
+        section.termsPos = alignUp(section.offsetsPos + index->offsets().size() * sizeof(uint32_t));
+        end = section.termsPos + section.numTerms * sizeof(uint32_t);
+    };
+    place(bundle.mlogaIndex, h.mloga);
+    place(bundle.logGapIndex, h.logGap);
+    h.fileSize = end;
+
+    std::string tmpPath = path + ".tmp." + std::to_string(::getpid());
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            throw std::runtime_error("Could not write dataset cache: " + tmpPath);
+        }
+        auto seekTo = [&out](uint64_t pos) {
+            static const char zeros[alignment] = {};
+            out.write(zeros, static_cast<std::streamsize>(pos - static_cast<uint64_t>(out.tellp())));
+        };
+        auto writeArray = [&out](const uint32_t* data, std::size_t count) {
+            out.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(count * sizeof(uint32_t)));
+        };
+
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        seekTo(h.offsetsPos);
+        writeArray(demand.offsets().data(), demand.offsets().size());
+        seekTo(h.entriesPos);
+        // entry by entry, so the padding after dst is written as zeros
+        std::vector<char> record(sizeof(demandEntry), 0);
+        for (const auto& e : demand.entries()) {
+            std::memcpy(record.data(), &e.dst, sizeof(e.dst));
+            std::memcpy(record.data() + offsetof(demandEntry, weight), &e.weight, sizeof(e.weight));
+            out.write(record.data(), static_cast<std::streamsize>(record.size()));
+        }
+        auto writeIndex = [&](const std::optional<forwardIndex>& index, const indexSection& section) {
+            if (index) {
+                seekTo(section.offsetsPos);
+                writeArray(index->offsets().data(), index->offsets().size());
+                seekTo(section.termsPos);
+                writeArray(index->flatTerms().data(), section.numTerms);
+            }
+        };
+        writeIndex(bundle.mlogaIndex, h.mloga);
+        writeIndex(bundle.logGapIndex, h.logGap);
+        if (!out) {
+            throw std::runtime_error("Could not write dataset cache: " + tmpPath);
+        }
+    }
+    std::filesystem::rename(tmpPath, path);
+}
+
+/// Maps a cache written by writeDatasetCache. The returned demand and indexes view
+/// the mapping directly and keep it alive; nothing is copied or parsed.
+inline datasetBundle mapDatasetCache(const std::string& path) {
+    using namespace datasetCache;
+    auto file = std::make_shared<const mappedFile>(path);
+
+    auto fail = [&path](const std::string& why) {
+        return std::runtime_error("Invalid dataset cache " + path + ": " + why);
+    };
+    if (file->size() < sizeof(header)) {
+        throw fail("truncated header");
+    }
+    header h;
+    std::memcpy(&h, file->data(), sizeof(h));
+    if (std::memcmp(h.magic, magic, sizeof(magic)) != 0) {
+        throw fail("bad magic");
+    }
+    if (h.version != version || h.entrySize != sizeof(demandEntry)) {
+        throw fail("unsupported version or layout");
+    }
+    if (h.fileSize != file->size()) {
+        throw fail("size does not match header");
+    }
+
+    // the views go straight to the engines, so every offset and index is checked once here
+    auto isMonotone = [](const sharedArray<uint32_t>& offsets) {
+        return offsets[0] == 0 && std::is_sorted(offsets.begin(), offsets.end());
+    };
+
+    auto offsets = viewArray<uint32_t>(file, h.offsetsPos, h.numVertices + 1, path);
+    if (!isMonotone(offsets) || offsets[h.numVertices] != h.numEntries) {
+        throw fail("demand offsets are not monotone or do not cover the entries");
+    }
+    // rows are searched by dst, so each must be strictly increasing, as edgeAccumulator writes them
+    auto entries = viewArray<demandEntry>(file, h.entriesPos, h.numEntries, path);
+    for (uint64_t v = 0; v < h.numVertices; ++v) {
+        for (uint32_t i = offsets[v]; i < offsets[v + 1]; ++i) {
+            if (entries[i].dst >= h.numVertices) {
+                throw fail("demand entry out of range");
+            }
+            if (i > offsets[v] && entries[i].dst <= entries[i - 1].dst) {
+                throw fail("demand row not sorted by dst");
+            }
+        }
+    }
+    datasetBundle bundle(sparseDemand(h.numVertices, std::move(offsets), std::move(entries)));
+
+    auto index = [&](const indexSection& section) -> std::optional<forwardIndex> {
+        if (section.offsetsPos == 0) {
+            return std::nullopt;
+        }
+        // the engines read the terms of every vertex, so there is one document per vertex
+        if (section.documentCount != h.numVertices) {
+            throw fail("index does not have one document per vertex");
+        }
+        auto indexOffsets = viewArray<uint32_t>(file, section.offsetsPos, section.documentCount + 1, path);
+        if (!isMonotone(indexOffsets) || indexOffsets[section.documentCount] != section.numTerms) {
+            throw fail("index offsets are not monotone or do not cover the terms");
+        }
+        auto terms = viewArray<uint32_t>(file, section.termsPos, section.numTerms, path);
+        for (uint32_t term : terms) {
+            if (term >= section.termCount) {
+                throw fail("index term out of range");
+            }
+        }
+        return forwardIndex(std::move(terms), std::move(indexOffsets), section.termCount);
+    };
+    bundle.mlogaIndex = index(h.mloga);
+    bundle.logGapIndex = index(h.logGap);
+    return bundle;
+}
+
+/// Loads @p path, a text file in @p format, going through a binary cache where possible:
+///  - a cache file is mapped directly;
+///  - otherwise, with @p useCache, `path + ".bpds"` is mapped if it is at least as new
+///    as @p path and was built from a file of the same format and size, or @p parse(path)
+///    is run and its result (plus both forward indexes when @p withIndexes) is written
+///    there for the next run.
+template <typename Parse>
+datasetBundle loadWithCache(
+    const std::string& path, textFormat format, bool useCache, bool withIndexes, Parse parse
+) {
+    if (isDatasetCache(path)) {
+        return mapDatasetCache(path);
+    }
+    if (!useCache) {
+        return datasetBundle(parse(path));
+    }
+
+    namespace fs = std::filesystem;
+    std::string cachePath = path + datasetCache::extension;
+    bool haveSource = fs::exists(path);
+    uint64_t sourceSize = haveSource ? fs::file_size(path) : 0;
+    datasetCache::header h{};
+    if (datasetCache::readHeader(cachePath, h)
+        && (!haveSource
+            || (h.version == datasetCache::version
+                && fs::last_write_time(cachePath) >= fs::last_write_time(path)
+                && h.sourceFormat == static_cast<uint32_t>(format) && h.sourceSize == sourceSize))) {
+        return mapDatasetCache(cachePath);
+    }
+
+    datasetBundle bundle(parse(path));
+    if (withIndexes) {
+        bundle.mlogaIndex = createMlogaForwardIndex(bundle.demand);
+        bundle.logGapIndex = createLogGapForwardIndex(bundle.demand);
+    }
+    writeDatasetCache(cachePath, bundle, format, sourceSize);
+    return bundle;
+}
+
+} // namespace pisa
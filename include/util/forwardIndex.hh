@@ -1,10 +1,35 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <utility>
 #include <vector>
 
+#include "util/sharedArray.hh"
+
 namespace pisa {
 
+/// Non-owning view over the contiguous term IDs of one document.
+/// Valid as long as the owning forwardIndex is alive and unmodified.
+class termSpan {
+  public:
+    using value_type = uint32_t;
+    using const_iterator = const uint32_t*;
+
+    termSpan() = default;
+    termSpan(const uint32_t* first, const uint32_t* last) : m_first(first), m_last(last) {}
+
+    [[nodiscard]] const_iterator begin() const { return m_first; }
+    [[nodiscard]] const_iterator end() const { return m_last; }
+    [[nodiscard]] std::size_t size() const { return static_cast<std::size_t>(m_last - m_first); }
+    [[nodiscard]] bool empty() const { return m_first == m_last; }
+    const uint32_t& operator[](std::size_t i) const { return m_first[i]; }
+
+  private:
+    const uint32_t* m_first = nullptr;
+    const uint32_t* m_last = nullptr;
+};
+
 class forwardIndex {
   public:
     forwardIndex() = default;
@@ -14,25 +39,47 @@ class forwardIndex {
     /// @param termCount total number of unique terms (defines the term-ID space)
     forwardIndex(const std::vector<std::vector<uint32_t>>& docTerms, std::size_t termCount)
         : m_termCount(termCount) {
-        m_offsets.reserve(docTerms.size() + 1);
-        m_offsets.push_back(0);
+        std::vector<uint32_t> flat;
+        std::vector<uint32_t> offsets;
+        offsets.reserve(docTerms.size() + 1);
+        offsets.push_back(0);
         for (const auto& terms : docTerms) {
-            m_terms.insert(m_terms.end(), terms.begin(), terms.end());
-            m_offsets.push_back(static_cast<uint32_t>(m_terms.size()));
+            flat.insert(flat.end(), terms.begin(), terms.end());
+            offsets.push_back(static_cast<uint32_t>(flat.size()));
         }
+        m_terms = std::move(flat);
+        m_offsets = std::move(offsets);
     }
 
+    /// Adopt an already flattened index: the terms of document d are
+    /// terms[offsets[d], offsets[d + 1]). The arrays may also view a mapped file.
+    forwardIndex(sharedArray<uint32_t> terms, sharedArray<uint32_t> offsets, std::size_t termCount)
+        : m_termCount(termCount), m_terms(std::move(terms)), m_offsets(std::move(offsets)) {}
+
     [[nodiscard]] std::size_t termCount() const { return m_termCount; }
+    [[nodiscard]] std::size_t documentCount() const {
+        return m_offsets.empty() ? 0 : m_offsets.size() - 1;
+    }
 
     [[nodiscard]] std::vector<uint32_t> terms(uint32_t doc) const {
         return {m_terms.begin() + m_offsets[doc],
                 m_terms.begin() + m_offsets[doc + 1]};
     }
 
+    /// Zero-copy access to the terms of @p doc; used on the bisection hot path.
+    [[nodiscard]] termSpan termsView(uint32_t doc) const {
+        const uint32_t* base = m_terms.data();
+        return {base + m_offsets[doc], base + m_offsets[doc + 1]};
+    }
+
+    /// Raw CSR arrays: offsets() has documentCount() + 1 entries.
+    [[nodiscard]] const sharedArray<uint32_t>& flatTerms() const { return m_terms; }
+    [[nodiscard]] const sharedArray<uint32_t>& offsets() const { return m_offsets; }
+
   private:
     std::size_t m_termCount = 0;
-    std::vector<uint32_t> m_terms;
-    std::vector<uint32_t> m_offsets;
+    sharedArray<uint32_t> m_terms;
+    sharedArray<uint32_t> m_offsets;
 };
 
 } // namespace pisa
@@ -5,6 +5,7 @@
 
 #include <core/util.hh>
 #include <util/forwardIndex.hh>
+#include <util/sparseDemand.hh>
 
 namespace pisa {
 
@@ -40,4 +41,47 @@ inline forwardIndex createMlogaForwardIndex(const std::vector<std::vector<double
     return forwardIndex(docTerms, edgeId);
 }
 
+/// Sparse counterpart of createLogGapForwardIndex: O(n + non-zeros).
+inline forwardIndex createLogGapForwardIndex(const sparseDemand& demand) {
+    uint32_t n = demand.numVertices();
+    std::vector<std::vector<uint32_t>> docTerms(n);
+    for (uint32_t i = 0; i < n; ++i) {
+        for (const auto& e : demand.row(i)) {
+            if (i != e.dst && !isClose(e.weight, 0.0)) {
+                docTerms[i].push_back(e.dst);
+            }
+        }
+    }
+    return forwardIndex(docTerms, n);
+}
+
+/// Sparse counterpart of createMlogaForwardIndex. Folds (i, j) and (j, i) onto
+/// the upper triangle first, so edge IDs match the dense builder exactly.
+inline forwardIndex createMlogaForwardIndex(const sparseDemand& demand) {
+    uint32_t n = demand.numVertices();
+    edgeAccumulator upper(n);
+    upper.reserve(demand.numEntries());
+    for (uint32_t i = 0; i < n; ++i) {
+        for (const auto& e : demand.row(i)) {
+            upper.add(std::min(i, e.dst), std::max(i, e.dst), e.weight);
+        }
+    }
+    auto folded = upper.build();
+
+    std::vector<std::vector<uint32_t>> docTerms(n);
+    uint32_t edgeId = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        for (const auto& e : folded.row(i)) {
+            if (!isClose(e.weight, 0.0)) {
+                docTerms[i].push_back(edgeId);
+                if (i != e.dst) {
+                    docTerms[e.dst].push_back(edgeId);
+                }
+                edgeId++;
+            }
+        }
+    }
+    return forwardIndex(docTerms, edgeId);
+}
+
 } // namespace pisa
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    #include <immintrin.h>
+    #define PISA_GAIN_KERNEL_X86 1
+#endif
+
+#include "util/forwardIndex.hh"
+#include "util/singleInitVector.hh"
+
+namespace pisa::bp {
+
+/// Per-degree move deltas of f(d) = d * log2(d + 1).
+///
+/// Moving a vertex changes a term's cost by (L1 - L2) + from[d1] + to[d2], where d1/d2
+/// are the term's degrees on the source/destination side and L1/L2 their log sizes,
+/// so a vertex gain needs only two table loads per term. The table is sized to the
+/// largest term degree of the index, so it fits in cache for sparse demands.
+class moveGainTable {
+  public:
+    moveGainTable() = default;
+
+    explicit moveGainTable(std::size_t max_degree)
+        : m_from(max_degree + 1, 0.0), m_to(max_degree + 1, 0.0) {
+        auto f = [](std::size_t d) {
+            return static_cast<double>(d) * std::log2(static_cast<double>(d) + 1.0);
+        };
+        for (std::size_t d = 0; d <= max_degree; ++d) {
+            m_from[d] = d == 0 ? 0.0 : f(d - 1) - f(d);
+            m_to[d] = f(d + 1) - f(d);
+        }
+    }
+
+    [[nodiscard]] bool empty() const { return m_from.empty(); }
+    [[nodiscard]] std::size_t size() const { return m_from.size(); }
+    [[nodiscard]] const double* from_data() const { return m_from.data(); }
+    [[nodiscard]] const double* to_data() const { return m_to.data(); }
+
+  private:
+    std::vector<double> m_from;
+    std::vector<double> m_to;
+};
+
+/// Sum of from[d1(t)] + to[d2(t)] over @p terms.
+using moveDeltaFn = double (*)(termSpan, const degreeMap&, const degreeMap&, const moveGainTable&);
+
+enum class gainKernelIsa { scalar, avx2, avx512 };
+
+inline double moveDeltasScalar(
+    termSpan terms, const degreeMap& from_lex, const degreeMap& to_lex, const moveGainTable& table
+) {
+    const double* from = table.from_data();
+    const double* to = table.to_data();
+    double sum = 0.0;
+    for (const auto& t: terms) {
+        sum += from[from_lex[t]] + to[to_lex[t]];
+    }
+    return sum;
+}
+
+#ifdef PISA_GAIN_KERNEL_X86
+
+__attribute__((target("avx2"))) inline __m256i
+gatherDegrees(const degreeMap& lex, __m256i idx, __m256i mask) {
+    const __m256i zero = _mm256_setzero_si256();
+    auto gen = _mm256_mask_i32gather_epi32(
+        zero, reinterpret_cast<const int*>(lex.generation_data()), idx, mask, 4
+    );
+    auto val = _mm256_mask_i32gather_epi32(
+        zero, reinterpret_cast<const int*>(lex.value_data()), idx, mask, 4
+    );
+    auto live = _mm256_cmpeq_epi32(gen, _mm256_set1_epi32(static_cast<int>(lex.m_generation)));
+    return _mm256_and_si256(val, _mm256_and_si256(live, mask));
+}
+
+__attribute__((target("avx2"))) inline __m256d
+gatherDeltas(const double* table, __m128i degrees, __m128i mask) {
+    return _mm256_mask_i32gather_pd(
+        _mm256_setzero_pd(), table, degrees, _mm256_castsi256_pd(_mm256_cvtepi32_epi64(mask)), 8
+    );
+}
+
+__attribute__((target("avx2"))) inline double moveDeltasAvx2(
+    termSpan terms, const degreeMap& from_lex, const degreeMap& to_lex, const moveGainTable& table
+) {
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256d acc = _mm256_setzero_pd();
+    const auto n = static_cast<int>(terms.size());
+    for (int i = 0; i < n; i += 8) {
+        auto mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(n - i), lanes);
+        auto idx = _mm256_maskload_epi32(reinterpret_cast<const int*>(terms.begin() + i), mask);
+        auto d1 = gatherDegrees(from_lex, idx, mask);
+        auto d2 = gatherDegrees(to_lex, idx, mask);
+        auto mask_lo = _mm256_castsi256_si128(mask);
+        auto mask_hi = _mm256_extracti128_si256(mask, 1);
+        acc = _mm256_add_pd(acc, gatherDeltas(table.from_data(), _mm256_castsi256_si128(d1), mask_lo));
+        acc = _mm256_add_pd(acc, gatherDeltas(table.from_data(), _mm256_extracti128_si256(d1, 1), mask_hi));
+        acc = _mm256_add_pd(acc, gatherDeltas(table.to_data(), _mm256_castsi256_si128(d2), mask_lo));
+        acc = _mm256_add_pd(acc, gatherDeltas(table.to_data(), _mm256_extracti128_si256(d2, 1), mask_hi));
+    }
+    alignas(32) double partial[4];
+    _mm256_store_pd(partial, acc);
+    return partial[0] + partial[1] + partial[2] + partial[3];
+}
+
+// GCC flags the undefined upper lanes used inside the AVX-512 cast intrinsics.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wuninitialized"
+
+__attribute__((target("avx512f"))) inline __m512i
+gatherDegrees512(const degreeMap& lex, __m512i idx, __mmask16 mask) {
+    const __m512i zero = _mm512_setzero_si512();
+    auto gen = _mm512_mask_i32gather_epi32(zero, mask, idx, lex.generation_data(), 4);
+    auto val = _mm512_mask_i32gather_epi32(zero, mask, idx, lex.value_data(), 4);
+    auto live = _mm512_mask_cmpeq_epi32_mask(
+        mask, gen, _mm512_set1_epi32(static_cast<int>(lex.m_generation))
+    );
+    return _mm512_maskz_mov_epi32(live, val);
+}
+
+__attribute__((target("avx512f"))) inline double moveDeltasAvx512(
+    termSpan terms, const degreeMap& from_lex, const degreeMap& to_lex, const moveGainTable& table
+) {
+    __m512d acc = _mm512_setzero_pd();
+    const auto n = static_cast<int>(terms.size());
+    for (int i = 0; i < n; i += 16) {
+        const int remaining = n - i;
+        const __mmask16 mask = remaining >= 16 ? 0xFFFF : static_cast<__mmask16>((1u << remaining) - 1);
+        auto idx = _mm512_maskz_loadu_epi32(mask, terms.begin() + i);
+        auto d1 = gatherDegrees512(from_lex, idx, mask);
+        auto d2 = gatherDegrees512(to_lex, idx, mask);
+        const auto lo = static_cast<__mmask8>(mask);
+        const auto hi = static_cast<__mmask8>(mask >> 8);
+        const __m512d zero = _mm512_setzero_pd();
+        acc = _mm512_add_pd(acc, _mm512_mask_i32gather_pd(zero, lo, _mm512_castsi512_si256(d1), table.from_data(), 8));
+        acc = _mm512_add_pd(acc, _mm512_mask_i32gather_pd(zero, hi, _mm512_extracti64x4_epi64(d1, 1), table.from_data(), 8));
+        acc = _mm512_add_pd(acc, _mm512_mask_i32gather_pd(zero, lo, _mm512_castsi512_si256(d2), table.to_data(), 8));
+        acc = _mm512_add_pd(acc, _mm512_mask_i32gather_pd(zero, hi, _mm512_extracti64x4_epi64(d2, 1), table.to_data(), 8));
+    }
+    return _mm512_reduce_add_pd(acc);
+}
+
+#pragma GCC diagnostic pop
+
+#endif
+
+/// Best kernel the running CPU supports.
+inline gainKernelIsa detectGainKernelIsa() {
+#ifdef PISA_GAIN_KERNEL_X86
+    if (__builtin_cpu_supports("avx512f")) {
+        return gainKernelIsa::avx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return gainKernelIsa::avx2;
+    }
+#endif
+    return gainKernelIsa::scalar;
+}
+
+inline moveDeltaFn moveDeltaKernel(gainKernelIsa isa = detectGainKernelIsa()) {
+#ifdef PISA_GAIN_KERNEL_X86
+    switch (isa) {
+    case gainKernelIsa::avx512:
+        return moveDeltasAvx512;
+    case gainKernelIsa::avx2:
+        return moveDeltasAvx2;
+    case gainKernelIsa::scalar:
+        break;
+    }
+#endif
+    return moveDeltasScalar;
+}
+
+}  // namespace pisa::bp
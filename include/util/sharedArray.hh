@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+
+namespace pisa {
+
+/// Immutable array whose storage is either an owned std::vector or memory owned by
+/// someone else (e.g. a mapped dataset file), kept alive by a shared owner handle.
+/// Copies share the storage, so CSR structures built on it copy in O(1).
+template <typename T>
+class sharedArray {
+  public:
+    using const_iterator = const T*;
+
+    sharedArray() = default;
+    sharedArray(std::initializer_list<T> values) : sharedArray(std::vector<T>(values)) {}
+
+    sharedArray(std::vector<T> values) {
+        auto owned = std::make_shared<const std::vector<T>>(std::move(values));
+        m_data = owned->data();
+        m_size = owned->size();
+        m_owner = std::move(owned);
+    }
+
+    /// Views @p size elements at @p data; @p owner must keep them valid.
+    sharedArray(std::shared_ptr<const void> owner, const T* data, std::size_t size)
+        : m_owner(std::move(owner)), m_data(data), m_size(size) {}
+
+    [[nodiscard]] const T* data() const { return m_data; }
+    [[nodiscard]] std::size_t size() const { return m_size; }
+    [[nodiscard]] bool empty() const { return m_size == 0; }
+    [[nodiscard]] const_iterator begin() const { return m_data; }
+    [[nodiscard]] const_iterator end() const { return m_data + m_size; }
+    const T& operator[](std::size_t i) const { return m_data[i]; }
+
+  private:
+    std::shared_ptr<const void> m_owner;
+    const T* m_data = nullptr;
+    std::size_t m_size = 0;
+};
+
+} // namespace pisa
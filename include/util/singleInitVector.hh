@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
 #include <vector>
 
 template <class T>
@@ -57,7 +59,56 @@ class singleInitVector: public std::vector<singleInitEntry<T>> {
     T m_defaultValue = Default<T>::value;
 };
 
+/// Structure-of-arrays counterpart of singleInitVector: values and generations
+/// live in separate arrays and generations are narrow, so a lookup touches
+/// fewer cache lines. When the generation counter wraps, all stamps are reset.
+template <class T, class Generation = uint32_t>
+class singleInitSoAVector {
+  public:
+    singleInitSoAVector() = default;
+    explicit singleInitSoAVector(std::size_t size) { resize(size); }
+
+    std::size_t size() const { return m_values.size(); }
+
+    void resize(std::size_t size) {
+        m_values.resize(size);
+        m_generations.resize(size, 0);
+    }
+
+    const T& operator[](std::size_t i) const {
+        return m_generations[i] == m_generation ? m_values[i] : m_defaultValue;
+    }
+
+    bool has_value(std::size_t i) const { return m_generations[i] == m_generation; }
+
+    /// Raw arrays for gather-based kernels; an entry is live iff its stamp equals m_generation.
+    const T* value_data() const { return m_values.data(); }
+    const Generation* generation_data() const { return m_generations.data(); }
+
+    void set(std::size_t i, const T& v) {
+        m_values[i] = v;
+        m_generations[i] = m_generation;
+    }
+
+    void clear() {
+        if (++m_generation == 0) [[unlikely]] {
+            std::fill(m_generations.begin(), m_generations.end(), Generation{0});
+            m_generation = 1;
+        }
+    }
+
+    Generation m_generation = 1;
+    T m_defaultValue = Default<T>::value;
+
+  private:
+    std::vector<T> m_values;
+    std::vector<Generation> m_generations;
+};
+
+/// Per-term degree map used by the BP engine; degrees never exceed the vertex count.
+using degreeMap = singleInitSoAVector<uint32_t>;
+
 struct degreeMapPair {
-    singleInitVector<std::size_t>& left;
-    singleInitVector<std::size_t>& right;
+    degreeMap& left;
+    degreeMap& right;
 };
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "util/sharedArray.hh"
+
+namespace pisa {
+
+struct demandEntry {
+    uint32_t dst;
+    double weight;
+};
+
+/// Non-owning view over the non-zero entries of one demand-matrix row.
+class demandRow {
+  public:
+    using const_iterator = const demandEntry*;
+
+    demandRow(const demandEntry* first, const demandEntry* last) : m_first(first), m_last(last) {}
+
+    [[nodiscard]] const_iterator begin() const { return m_first; }
+    [[nodiscard]] const_iterator end() const { return m_last; }
+    [[nodiscard]] std::size_t size() const { return static_cast<std::size_t>(m_last - m_first); }
+    [[nodiscard]] bool empty() const { return m_first == m_last; }
+
+  private:
+    const demandEntry* m_first;
+    const demandEntry* m_last;
+};
+
+/// Demand matrix in CSR form: only non-zero (src, dst) cells are stored,
+/// rows sorted by dst. Memory is O(n + non-zeros) instead of O(n^2).
+/// Immutable once built; copies share the arrays, which may live in a mapped file.
+class sparseDemand {
+  public:
+    sparseDemand() = default;
+
+    sparseDemand(std::size_t numVertices, sharedArray<uint32_t> offsets, sharedArray<demandEntry> entries)
+        : m_numVertices(numVertices), m_offsets(std::move(offsets)), m_entries(std::move(entries)) {}
+
+    /// Keeps every cell that is exactly non-zero; tolerance checks are left to consumers.
+    static sparseDemand fromDense(const std::vector<std::vector<double>>& demandMatrix) {
+        std::size_t n = demandMatrix.size();
+        std::vector<uint32_t> offsets;
+        std::vector<demandEntry> entries;
+        offsets.reserve(n + 1);
+        offsets.push_back(0);
+        for (std::size_t src = 0; src < n; ++src) {
+            for (std::size_t dst = 0; dst < demandMatrix[src].size(); ++dst) {
+                if (demandMatrix[src][dst] != 0.0) {
+                    entries.push_back({static_cast<uint32_t>(dst), demandMatrix[src][dst]});
+                }
+            }
+            offsets.push_back(static_cast<uint32_t>(entries.size()));
+        }
+        return {n, std::move(offsets), std::move(entries)};
+    }
+
+    [[nodiscard]] std::size_t numVertices() const { return m_numVertices; }
+    [[nodiscard]] std::size_t numEntries() const { return m_entries.size(); }
+
+    /// Raw CSR arrays: offsets() has numVertices() + 1 entries, entries() numEntries().
+    [[nodiscard]] const sharedArray<uint32_t>& offsets() const { return m_offsets; }
+    [[nodiscard]] const sharedArray<demandEntry>& entries() const { return m_entries; }
+
+    [[nodiscard]] demandRow row(uint32_t src) const {
+        const demandEntry* base = m_entries.data();
+        return {base + m_offsets[src], base + m_offsets[src + 1]};
+    }
+
+    /// O(log deg) lookup of a single cell; returns 0 for absent entries.
+    [[nodiscard]] double weight(uint32_t src, uint32_t dst) const {
+        auto r = row(src);
+        auto it = std::lower_bound(r.begin(), r.end(), dst, [](const demandEntry& e, uint32_t d) {
+            return e.dst < d;
+        });
+        return (it != r.end() && it->dst == dst) ? it->weight : 0.0;
+    }
+
+    /// Same demands with src and dst exchanged: row v lists every (u, w) with w = weight(u, v).
+    [[nodiscard]] sparseDemand transposed() const;
+
+    /// Undirected view: row u lists every v with weight(u, v) + weight(v, u) non-zero.
+    [[nodiscard]] sparseDemand symmetrised() const;
+
+    /// Materialises the dense matrix, for the legacy engines that still need it.
+    [[nodiscard]] std::vector<std::vector<double>> toDense() const {
+        std::vector<std::vector<double>> demandMatrix(m_numVertices, std::vector<double>(m_numVertices, 0.0));
+        for (uint32_t src = 0; src < m_numVertices; ++src) {
+            for (const auto& e: row(src)) {
+                demandMatrix[src][e.dst] = e.weight;
+            }
+        }
+        return demandMatrix;
+    }
+
+  private:
+    std::size_t m_numVertices = 0;
+    sharedArray<uint32_t> m_offsets{0};
+    sharedArray<demandEntry> m_entries;
+};
+
+/// How edgeAccumulator::build folds repeated (src, dst) cells.
+enum class duplicateCells {
+    sum,        ///< request traces: every repeat adds to the demand
+    keepLast,   ///< weight files: like assigning into a dense matrix, the last value wins
+                ///< and cells left at exactly zero are dropped
+};
+
+/// COO accumulator: collects (src, dst, weight) triples as they are streamed
+/// in and compacts them into a sparseDemand, summing duplicate cells.
+class edgeAccumulator {
+  public:
+    explicit edgeAccumulator(std::size_t numVertices) : m_numVertices(numVertices) {}
+
+    void reserve(std::size_t numTriples) {
+        m_src.reserve(numTriples);
+        m_entries.reserve(numTriples);
+    }
+
+    void add(uint32_t src, uint32_t dst, double weight = 1.0) {
+        if (src >= m_numVertices || dst >= m_numVertices) {
+            throw std::out_of_range(
+                "Edge (" + std::to_string(src) + "," + std::to_string(dst) + ") out of range."
+            );
+        }
+        m_src.push_back(src);
+        m_entries.push_back({dst, weight});
+    }
+
+    /// Adds both (src, dst) and (dst, src), matching the undirected trace semantics.
+    void addUndirected(uint32_t src, uint32_t dst, double weight = 1.0) {
+        add(src, dst, weight);
+        add(dst, src, weight);
+    }
+
+    [[nodiscard]] std::size_t size() const { return m_entries.size(); }
+
+    /// Counting sort by src, then sort + merge each row by dst. The counting sort keeps
+    /// insertion order within a row, so keepLast stable-sorts to find the last value.
+    [[nodiscard]] sparseDemand build(duplicateCells duplicates = duplicateCells::sum) const {
+        std::vector<uint32_t> offsets(m_numVertices + 1, 0);
+        for (auto src: m_src) {
+            ++offsets[src + 1];
+        }
+        for (std::size_t v = 0; v < m_numVertices; ++v) {
+            offsets[v + 1] += offsets[v];
+        }
+
+        std::vector<demandEntry> entries(m_entries.size());
+        {
+            std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+            for (std::size_t i = 0; i < m_entries.size(); ++i) {
+                entries[cursor[m_src[i]]++] = m_entries[i];
+            }
+        }
+
+        std::vector<uint32_t> mergedOffsets(m_numVertices + 1, 0);
+        std::size_t out = 0;
+        for (std::size_t v = 0; v < m_numVertices; ++v) {
+            auto first = entries.begin() + offsets[v];
+            auto last = entries.begin() + offsets[v + 1];
+            auto byDst = [](const demandEntry& a, const demandEntry& b) { return a.dst < b.dst; };
+            if (duplicates == duplicateCells::keepLast) {
+                std::stable_sort(first, last, byDst);
+            } else {
+                std::sort(first, last, byDst);
+            }
+            for (auto it = first; it != last; ++it) {
+                if (out > mergedOffsets[v] && entries[out - 1].dst == it->dst) {
+                    if (duplicates == duplicateCells::keepLast) {
+                        entries[out - 1].weight = it->weight;
+                    } else {
+                        entries[out - 1].weight += it->weight;
+                    }
+                } else {
+                    entries[out++] = *it;
+                }
+            }
+            if (duplicates == duplicateCells::keepLast) {
+                auto rowFirst = entries.begin() + mergedOffsets[v];
+                out = std::remove_if(rowFirst, entries.begin() + out, [](const demandEntry& e) {
+                    return e.weight == 0.0;
+                }) - entries.begin();
+            }
+            mergedOffsets[v + 1] = static_cast<uint32_t>(out);
+        }
+        entries.resize(out);
+        entries.shrink_to_fit();
+
+        return {m_numVertices, std::move(mergedOffsets), std::move(entries)};
+    }
+
+  private:
+    std::size_t m_numVertices;
+    std::vector<uint32_t> m_src;
+    std::vector<demandEntry> m_entries;
+};
+
+inline sparseDemand sparseDemand::transposed() const {
+    edgeAccumulator acc(m_numVertices);
+    acc.reserve(m_entries.size());
+    for (uint32_t src = 0; src < m_numVertices; ++src) {
+        for (const auto& e: row(src)) {
+            acc.add(e.dst, src, e.weight);
+        }
+    }
+    return acc.build();
+}
+
+inline sparseDemand sparseDemand::symmetrised() const {
+    edgeAccumulator acc(m_numVertices);
+    acc.reserve(2 * m_entries.size());
+    for (uint32_t src = 0; src < m_numVertices; ++src) {
+        for (const auto& e: row(src)) {
+            acc.addUndirected(src, e.dst, e.weight);
+        }
+    }
+    return acc.build();
+}
+
+} // namespace pisa
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <tbb/parallel_for.h>
+
+#include "util/sparseDemand.hh"
+
+namespace pisa {
+
+/// Text demand formats, both line based. Fields may be separated by commas, spaces
+/// or tabs, so either separator works with either format.
+enum class textFormat {
+    requests,   ///< "N,R" then R "src,dst" request lines; each request is undirected, weight 1.
+                ///< Only those R lines are read: anything after them is ignored, and a
+                ///< blank line among them counts toward R without adding a request.
+    weights,    ///< "N" then "src dst flow" lines; directed, the last flow of a cell wins
+};
+
+namespace textParse {
+
+/// Files smaller than this are parsed on the calling thread even when parallel.
+constexpr std::size_t parallelMinBytes = 1 << 20;
+/// Target size of the chunks a parallel parse hands to each task.
+constexpr std::size_t chunkBytes = 1 << 22;
+
+struct request {
+    uint32_t src;
+    uint32_t dst;
+};
+
+struct flow {
+    uint32_t src;
+    uint32_t dst;
+    double weight;
+};
+
+inline bool isSeparator(char c) { return c == ',' || c == ' ' || c == '\t' || c == '\r'; }
+
+/// Parses the next field of the line [p, eol) into @p value and advances @p p past it.
+/// Returns false once the line has no fields left.
+template <typename T>
+bool nextField(const char*& p, const char* eol, T& value) {
+    while (p < eol && isSeparator(*p)) {
+        ++p;
+    }
+    if (p == eol) {
+        return false;
+    }
+    auto [next, ec] = std::from_chars(p, eol, value);
+    if (ec != std::errc() || (next < eol && !isSeparator(*next))) {
+        throw std::runtime_error("Invalid field in: " + std::string(p, eol));
+    }
+    p = next;
+    return true;
+}
+
+inline const char* lineEnd(const char* p, const char* end) {
+    const void* eol = std::memchr(p, '\n', static_cast<std::size_t>(end - p));
+    return eol ? static_cast<const char*>(eol) : end;
+}
+
+/// Cuts [first, last) into pieces of about chunkBytes that each end just after a '\n',
+/// so every line falls in exactly one piece. Returns the piece boundaries.
+inline std::vector<const char*> splitAtLines(const char* first, const char* last, bool parallel) {
+    std::vector<const char*> bounds{first};
+    if (parallel && static_cast<std::size_t>(last - first) >= parallelMinBytes) {
+        const char* p = first;
+        while (static_cast<std::size_t>(last - p) > chunkBytes) {
+            p = lineEnd(p + chunkBytes, last);
+            if (p == last) {
+                break;
+            }
+            bounds.push_back(++p);
+        }
+    }
+    bounds.push_back(last);
+    return bounds;
+}
+
+/// Parses every line of [first, last) with @p parseLine(p, eol, out), one piece per
+/// task when @p parallel, and concatenates the per-piece results in file order.
+template <typename Record, typename ParseLine>
+std::vector<Record> parseLines(const char* first, const char* last, bool parallel, ParseLine parseLine) {
+    auto bounds = splitAtLines(first, last, parallel);
+    std::vector<std::vector<Record>> pieces(bounds.size() - 1);
+    auto parsePiece = [&](std::size_t i) {
+        auto& out = pieces[i];
+        out.reserve(static_cast<std::size_t>(bounds[i + 1] - bounds[i]) / 8);
+        for (const char* p = bounds[i]; p < bounds[i + 1];) {
+            const char* eol = lineEnd(p, bounds[i + 1]);
+            parseLine(p, eol, out);
+            p = eol + 1;
+        }
+    };
+    if (pieces.size() == 1) {
+        parsePiece(0);
+        return std::move(pieces[0]);
+    }
+    tbb::parallel_for(std::size_t{0}, pieces.size(), parsePiece);
+
+    std::size_t total = 0;
+    for (const auto& piece : pieces) {
+        total += piece.size();
+    }
+    std::vector<Record> records;
+    records.reserve(total);
+    for (const auto& piece : pieces) {
+        records.insert(records.end(), piece.begin(), piece.end());
+    }
+    return records;
+}
+
+} // namespace textParse
+
+/// Parses a demand held in memory. The per-line work (integer and float conversion
+/// with std::from_chars, no locale or stream state) runs in parallel over line-aligned
+/// chunks when @p parallel; the demand is then assembled serially in file order.
+inline sparseDemand parseDemandText(std::string_view text, textFormat format, bool parallel = true) {
+    using namespace textParse;
+    const char* p = text.data();
+    const char* end = text.data() + text.size();
+
+    const char* eol = lineEnd(p, end);
+    std::size_t numVertices = 0;
+    std::size_t numRequests = 0;
+    if (!nextField(p, eol, numVertices)) {
+        throw std::runtime_error("File is empty or invalid format.");
+    }
+    if (format == textFormat::requests && !nextField(p, eol, numRequests)) {
+        throw std::runtime_error("Missing request count in header.");
+    }
+    const char* body = eol < end ? eol + 1 : end;
+
+    auto checkVertices = [numVertices](uint32_t src, uint32_t dst, const char* line, const char* lineEnd) {
+        if (src >= numVertices || dst >= numVertices) {
+            throw std::runtime_error("Invalid vertex index in: " + std::string(line, lineEnd));
+        }
+    };
+
+    edgeAccumulator edges(numVertices);
+    if (format == textFormat::requests) {
+        // the body ends after the R-th line, as the stream loader stopped reading there
+        const char* bodyEnd = body;
+        for (std::size_t lines = 0; lines < numRequests; ++lines) {
+            if (bodyEnd == end) {
+                throw std::runtime_error("Not enough lines for the specified number of requests.");
+            }
+            bodyEnd = lineEnd(bodyEnd, end);
+            bodyEnd = bodyEnd < end ? bodyEnd + 1 : end;
+        }
+        auto requests = parseLines<request>(body, bodyEnd, parallel, [&](const char* q, const char* qEnd, auto& out) {
+            const char* line = q;
+            request r{};
+            if (!nextField(q, qEnd, r.src)) {
+                return;   // blank line
+            }
+            if (!nextField(q, qEnd, r.dst)) {
+                throw std::runtime_error("Invalid request line: " + std::string(line, qEnd));
+            }
+            checkVertices(r.src, r.dst, line, qEnd);
+            out.push_back(r);
+        });
+        edges.reserve(2 * requests.size());
+        for (const auto& r : requests) {
+            edges.addUndirected(r.src, r.dst);
+        }
+        return edges.build();
+    }
+
+    auto flows = parseLines<flow>(body, end, parallel, [&](const char* q, const char* qEnd, auto& out) {
+        const char* line = q;
+        flow f{};
+        if (!nextField(q, qEnd, f.src)) {
+            return;
+        }
+        if (!nextField(q, qEnd, f.dst) || !nextField(q, qEnd, f.weight)) {
+            throw std::runtime_error("Invalid weight line: " + std::string(line, qEnd));
+        }
+        checkVertices(f.src, f.dst, line, qEnd);
+        out.push_back(f);
+    });
+    edges.reserve(flows.size());
+    for (const auto& f : flows) {
+        edges.add(f.src, f.dst, f.weight);
+    }
+    return edges.build(duplicateCells::keepLast);
+}
+
+/// Reads the whole of @p path in one go.
+inline std::string readTextFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open file: " + path);
+    }
+    std::string text(static_cast<std::size_t>(file.tellg()), '\0');
+    file.seekg(0);
+    file.read(text.data(), static_cast<std::streamsize>(text.size()));
+    return text;
+}
+
+inline sparseDemand parseDemandFile(const std::string& path, textFormat format, bool parallel = true) {
+    return parseDemandText(readTextFile(path), format, parallel);
+}
+
+} // namespace pisa
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstdint>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include <util/sparseDemand.hh>
+
+namespace pisa {
+
+/// Implicit balanced BST over positions [0, n), using the same split rule as
+/// buildBalancedBinaryTree (root = (l + r) / 2). Distances are answered by
+/// descending to the LCA, so no adjacency list or n x n table is needed.
+class balancedTreeDistance {
+  public:
+    explicit balancedTreeDistance(uint32_t n) : m_size(n), m_depth(n, 0) { fillDepths(0, n, 0); }
+
+    [[nodiscard]] uint32_t size() const { return m_size; }
+    [[nodiscard]] uint32_t depth(uint32_t pos) const { return m_depth[pos]; }
+
+    /// Position of the lowest common ancestor of @p a and @p b, O(log n).
+    [[nodiscard]] uint32_t lca(uint32_t a, uint32_t b) const {
+        if (a > b) {
+            std::swap(a, b);
+        }
+        uint32_t l = 0;
+        uint32_t r = m_size;
+        while (true) {
+            uint32_t m = (l + r) / 2;
+            if (b < m) {
+                r = m;
+            } else if (a > m) {
+                l = m + 1;
+            } else {
+                return m;
+            }
+        }
+    }
+
+    [[nodiscard]] uint32_t distance(uint32_t a, uint32_t b) const {
+        return m_depth[a] + m_depth[b] - 2 * m_depth[lca(a, b)];
+    }
+
+  private:
+    void fillDepths(uint32_t l, uint32_t r, uint32_t d) {
+        if (l >= r) {
+            return;
+        }
+        uint32_t m = (l + r) / 2;
+        m_depth[m] = d;
+        fillDepths(l, m, d + 1);
+        fillDepths(m + 1, r, d + 1);
+    }
+
+    uint32_t m_size;
+    std::vector<uint32_t> m_depth;
+};
+
+/// Any BST over positions [0, n), given by the parent position of every position (-1 for
+/// the root), e.g. the tree optimalBST builds. In a search tree the LCA of a <= b is the
+/// shallowest position of [a, b], so it is answered in O(1) by a sparse table of range
+/// minima over the depths, built in O(n log n).
+class searchTreeDistance {
+  public:
+    explicit searchTreeDistance(const std::vector<int>& predecessors)
+        : m_size(predecessors.size()), m_depth(m_size, unknownDepth) {
+        std::vector<uint32_t> path;
+        for (uint32_t pos = 0; pos < m_size; ++pos) {
+            // climb to the root or to the first ancestor of known depth, then fill the path
+            int v = pos;
+            for (path.clear(); v != -1 && m_depth[v] == unknownDepth; v = predecessors[v]) {
+                path.push_back(v);
+            }
+            uint32_t d = v == -1 ? 0 : m_depth[v] + 1;
+            for (auto it = path.rbegin(); it != path.rend(); ++it) {
+                m_depth[*it] = d++;
+            }
+        }
+
+        m_shallowest.push_back(std::vector<uint32_t>(m_size));
+        std::iota(m_shallowest[0].begin(), m_shallowest[0].end(), 0);
+        for (uint32_t width = 2; width <= m_size; width *= 2) {
+            const auto& prev = m_shallowest.back();
+            std::vector<uint32_t> level(m_size - width + 1);
+            for (uint32_t pos = 0; pos + width <= m_size; ++pos) {
+                level[pos] = shallower(prev[pos], prev[pos + width / 2]);
+            }
+            m_shallowest.push_back(std::move(level));
+        }
+    }
+
+    [[nodiscard]] uint32_t size() const { return m_size; }
+    [[nodiscard]] uint32_t depth(uint32_t pos) const { return m_depth[pos]; }
+
+    [[nodiscard]] uint32_t lca(uint32_t a, uint32_t b) const {
+        if (a > b) {
+            std::swap(a, b);
+        }
+        uint32_t level = 31 - __builtin_clz(b - a + 1);
+        return shallower(m_shallowest[level][a], m_shallowest[level][b + 1 - (1u << level)]);
+    }
+
+    [[nodiscard]] uint32_t distance(uint32_t a, uint32_t b) const {
+        return m_depth[a] + m_depth[b] - 2 * m_depth[lca(a, b)];
+    }
+
+  private:
+    static constexpr uint32_t unknownDepth = ~0u;
+
+    [[nodiscard]] uint32_t shallower(uint32_t a, uint32_t b) const { return m_depth[b] < m_depth[a] ? b : a; }
+
+    uint32_t m_size;
+    std::vector<uint32_t> m_depth;
+    /// m_shallowest[k][pos]: shallowest position of [pos, pos + 2^k)
+    std::vector<std::vector<uint32_t>> m_shallowest;
+};
+
+/// Sum of weight * tree distance over the non-zero demands when @p ordering
+/// (ordering[pos] = vertex) is laid out on the positions of @p tree, O(E) distance queries.
+template <typename Tree>
+double layoutCost(const std::vector<uint32_t>& ordering, const sparseDemand& demand, const Tree& tree) {
+    uint32_t n = ordering.size();
+    std::vector<uint32_t> position(n);
+    for (uint32_t pos = 0; pos < n; ++pos) {
+        position[ordering[pos]] = pos;
+    }
+
+    double totalCost = 0;
+    for (uint32_t src = 0; src < n; ++src) {
+        for (const auto& e : demand.row(src)) {
+            totalCost += tree.distance(position[src], position[e.dst]) * e.weight;
+        }
+    }
+    return totalCost;
+}
+
+/// Cost of laying @p ordering out as a balanced BST, O(E log n).
+inline double balancedTreeCost(const std::vector<uint32_t>& ordering, const sparseDemand& demand) {
+    return layoutCost(ordering, demand, balancedTreeDistance(ordering.size()));
+}
+
+/// Cost of laying @p ordering out on the BST given by @p predecessors (parent position of
+/// every position), without re-running the DP that built it, O(E + n log n).
+inline double searchTreeCost(
+    const std::vector<uint32_t>& ordering, const std::vector<int>& predecessors, const sparseDemand& demand
+) {
+    return layoutCost(ordering, demand, searchTreeDistance(predecessors));
+}
+
+} // namespace pisa
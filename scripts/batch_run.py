@@ -1,9 +1,12 @@
 #!/usr/bin/env python3
 """Batch runner for the ``run`` executable
 
-This helper builds a list of parameter combinations and invokes the
-compiled ``bin/run`` program for each set.  It is intended to ease
-experiments by automating calls to the C++ driver in ``run.cc``.
+This helper builds a list of parameter combinations and hands them to the
+compiled ``bin/run`` program.  By default the whole grid goes to a single
+``bin/run`` invocation, which loads each dataset once, shares its forward
+indexes across runs and executes the runs concurrently, appending one row
+per run to ``<output-dir>/result.csv``.  With ``--subprocess-per-run`` it
+falls back to one process (and one output subdirectory) per combination.
 
 Usage examples
 --------------
@@ -21,17 +24,20 @@ Usage examples
         --datasets weights/test weights/high_locality \
         --output-dir results
 
-The script will create the output directory if necessary and print the
+The script will create the output directory if necessary and print each
 command before executing it.  If a subprocess returns a nonzero exit
 status the script stops immediately.
 
 The parameters accepted by the ``run`` binary are:
 
-* ``--algorithm`` – name of the algorithm (``mloga`` or ``mloggapa``).
+* ``--algorithm`` – name of a registered engine (``mloga``, ``loggap``,
+  ``basic``, ``onehop``, ``mloggap`` or ``noop``).
 * ``--max-depth`` – recursion depth for the reordering.
 * ``--max-iterations`` – iterations per level (default 20 in the C++ code).
 * ``--dataset-name`` – file path to the input dataset.
 * ``--output-directory`` – directory to store logs produced by ``run``.
+* ``--algorithms`` / ``--depths`` / ``--iterations`` / ``--datasets`` – the
+  grid form of the four options above, run in-process.
 
 """
 
@@ -44,7 +50,7 @@ import sys
 
 def parse_args() -> argparse.Namespace:
     p = argparse.ArgumentParser(description="Batch-run the `bin/run` executable")
-    p.add_argument("--algorithms", nargs="+", default=["mloga", "mloggapa"],
+    p.add_argument("--algorithms", nargs="+", default=["mloga", "mloggap"],
                    help="list of algorithm names to try")
     p.add_argument("--depths", nargs="+", type=int, default=[1, 2],
                    help="max depths to test")
@@ -54,6 +60,8 @@ def parse_args() -> argparse.Namespace:
                    help="dataset names or paths to feed to the program")
     p.add_argument("--output-dir", default="output_batch",
                    help="base directory where each run will write its logs")
+    p.add_argument("--subprocess-per-run", action="store_true",
+                   help="spawn bin/run once per combination instead of once per grid")
     p.add_argument("--dry-run", action="store_true",
                    help="print commands but do not execute")
     return p.parse_args()
@@ -68,6 +76,21 @@ def main():
 
     os.makedirs(args.output_dir, exist_ok=True)
 
+    if not args.subprocess_per_run:
+        cmd = [bin_path,
+               "--algorithms", *args.algorithms,
+               "--depths", *map(str, args.depths),
+               "--iterations", *map(str, args.iterations),
+               "--datasets", *args.datasets,
+               "--output-directory", args.output_dir]
+
+        print("Executing: ", " ".join(cmd))
+        if not args.dry_run:
+            ret = subprocess.run(cmd)
+            if ret.returncode != 0:
+                sys.exit(f"run failed with exit code {ret.returncode}")
+        return
+
     combinations = list(itertools.product(
         args.algorithms,
         args.depths,
@@ -95,7 +118,5 @@ def main():
                 sys.exit(f"run failed with exit code {ret.returncode}")
 
 
-del __all__
-
 if __name__ == "__main__":
     main()
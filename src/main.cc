@@ -12,6 +12,8 @@
 #include <graphbissection.hh>
 #include <mloggapbissection.hh>
 #include <onehopbissection.hh>
+#include <util/datasetCache.hh>
+#include <util/traceParser.hh>
 
 int main (int argc, char* argv[]) {
     unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
@@ -49,6 +51,24 @@ int main (int argc, char* argv[]) {
         .store_into(enabledAlgorithms)
         .help("Dot-separated list of algorithms to run (e.g., basic.mloggap.onehop)");
 
+    std::string obstSearch;
+    parser.add_argument("--obst-search")
+        .default_value(std::string("exhaustive"))
+        .store_into(obstSearch)
+        .help("OBST root search: exhaustive (exact, O(n^3)) or knuth (O(n^2) upper bound, reported as obst-knuth)");
+
+    bool reuseTrees;
+    parser.add_argument("--reuse-trees")
+        .flag()
+        .store_into(reuseTrees)
+        .help("price the OBST cached in orderings/ when it was built on the same ordering instead of re-running the DP");
+
+    bool datasetCache;
+    parser.add_argument("--dataset-cache")
+        .flag()
+        .store_into(datasetCache)
+        .help("map weights/<input-name>.bpds if it is up to date, else parse the weights and write it");
+
     try {
         parser.parse_args(argc, argv);
 
@@ -58,18 +78,55 @@ int main (int argc, char* argv[]) {
         std::exit(1);
     }
 
-    std::ifstream iFile("weights/" + inputName);
-    uint32_t nVertices;
-    iFile >> nVertices;
+    auto parseWeights = [](const std::string& path) {
+        return pisa::parseDemandFile(path, pisa::textFormat::weights);
+    };
 
-    uint32_t src, dst;
-    double flowSize;
-    std::vector<std::vector<double>> demandMatrix(nVertices, std::vector<double>(nVertices, 0.0));
-    while (iFile >> src >> dst >> flowSize) {
-        demandMatrix[src][dst] = flowSize;
+    // built once and shared by every ordering / cost evaluation below
+    pisa::sparseDemand demand = pisa::loadWithCache(
+        "weights/" + inputName, pisa::textFormat::weights, datasetCache, false, parseWeights
+    ).demand;
+    uint32_t nVertices = demand.numVertices();
+    std::vector<std::vector<double>> demandMatrix = demand.toDense();
+    mloggapa::Graph_t bipartiteGraph = mloggapa::bipartiteGraph(demand);
+    auto mloggapOrdering = [&bipartiteGraph] (
+        const auto&, std::vector<uint32_t>& vertices, VectorLimits_t limits,
+        uint32_t maxDepth, bool parallelize, BisectionRunRecord& record, uint32_t maxIterations
+    ) {
+        mloggapa::bipartiteGraphReordering(
+            bipartiteGraph, vertices, limits, maxDepth, parallelize, record, maxIterations
+        );
+    };
+    auto rawCost = [&demand] (const std::vector<uint32_t>& vertices, const auto&) {
+        return pisa::balancedTreeCost(vertices, demand);
+    };
+    auto greedyCost = [&demand] (const std::vector<uint32_t>& vertices, const auto&) {
+        return greedyConstructor(vertices, demand);
+    };
+    if (obstSearch != "exhaustive" && obstSearch != "knuth") {
+        std::cerr << "Unknown OBST root search: " << obstSearch << std::endl;
+        std::exit(1);
     }
+    RootSearch_t rootSearch = obstSearch == "knuth" ? RootSearch_t::KNUTH : RootSearch_t::EXHAUSTIVE;
+    std::string obstName = obstSearch == "knuth" ? "obst-knuth" : "obst";
 
     std::string baseFolderName = ("output/" + inputName + "/");
+    // the tree of every ordering is kept next to it as orderings/<test>_<obstName>.tree
+    auto obstCost = [&] (const std::string& flag) {
+        std::string treePath = baseFolderName + flag + "/orderings/" + std::to_string(testNumber) + "_" + obstName + ".tree";
+        return [&demand, rootSearch, reuseTrees, treePath] (const std::vector<uint32_t>& vertices, const auto&) {
+            if (reuseTrees && std::filesystem::exists(treePath)) {
+                std::vector<uint32_t> treeVertices;
+                ObstTree_t tree = readObstTree(treePath, treeVertices);
+                if (treeVertices == vertices) {
+                    return pisa::searchTreeCost(vertices, tree.predecessors, demand);
+                }
+            }
+            ObstTree_t tree = optimalBSTTree(vertices, demand, rootSearch);
+            writeObstTree(treePath, vertices, tree);
+            return tree.cost;
+        };
+    };
     namespace fs = std::filesystem;
 
     std::set<std::string> algorithmsToRun = { "noop" };
@@ -87,7 +144,7 @@ int main (int argc, char* argv[]) {
     std::vector<Ordering_t> allOrderAlgs = {
         { "noop",  "No Reordering", noop, vertices },
         { "basic",  "Basic Reordering", basic::graphReordering, vertices },
-        { "mloggap", "MLogGapA Reordering", mloggapa::bipartiteGraphReordering, vertices },
+        { "mloggap", "MLogGapA Reordering", mloggapOrdering, vertices },
         { "onehop", "OneHop Reordering", onehop::graphReordering, vertices },
         // …add more as needed…
     };
@@ -110,7 +167,7 @@ int main (int argc, char* argv[]) {
         if (algorithmsToRun.count(orderingAlg.flag)) {
             runTreeBuilder(
                 orderingAlg.flag, orderingAlg.label,
-                "raw", testGraphOrder,
+                "raw", rawCost,
                 orderingAlg.vertices, demandMatrix,
                 bounded, parallelize, nVertices,
                 baseFolderName, testNumber
@@ -118,7 +175,7 @@ int main (int argc, char* argv[]) {
 
             runTreeBuilder(
                 orderingAlg.flag, orderingAlg.label,
-                "greedy", testGreedy,
+                "greedy", greedyCost,
                 orderingAlg.vertices, demandMatrix,
                 bounded, parallelize, nVertices,
                 baseFolderName, testNumber
@@ -126,7 +183,7 @@ int main (int argc, char* argv[]) {
 
             runTreeBuilder(
                 orderingAlg.flag, orderingAlg.label,
-                "obst", testOBST,
+                obstName, obstCost(orderingAlg.flag),
                 orderingAlg.vertices, demandMatrix,
                 bounded, parallelize, nVertices,
                 baseFolderName, testNumber
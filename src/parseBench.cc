@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <argparse/argparse.hh>
+#include <util/sparseDemand.hh>
+#include <util/traceParser.hh>
+
+// The getline / stringstream / stoi loop bin/run used before traceParser.hh, kept as
+// the baseline the fast parser is measured against.
+pisa::sparseDemand parseWithStreams(const std::string& text) {
+    std::istringstream file(text);
+    std::string line;
+    size_t numVertices = 0;
+    size_t numRequests = 0;
+
+    if (std::getline(file, line)) {
+        std::stringstream ss(line);
+        std::string token;
+        if (std::getline(ss, token, ',')) {
+            numVertices = std::stoul(token);
+        }
+        if (std::getline(ss, token, ',')) {
+            numRequests = std::stoul(token);
+        }
+    }
+
+    pisa::edgeAccumulator edges(numVertices);
+    edges.reserve(2 * numRequests);
+    for (size_t i = 0; i < numRequests && std::getline(file, line); ++i) {
+        std::stringstream ss(line);
+        std::string token;
+        int src = -1, dst = -1;
+        if (std::getline(ss, token, ',')) {
+            src = std::stoi(token);
+        }
+        if (std::getline(ss, token, ',')) {
+            dst = std::stoi(token);
+        }
+        edges.addUndirected(src, dst);
+    }
+    return edges.build();
+}
+
+// keeps the demand of the last parse in @p result
+template<typename Parse>
+double secondsPerParse(int repeat, Parse parse, pisa::sparseDemand& result) {
+    const auto beginTime = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeat; ++r) {
+        result = parse();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - beginTime).count() / repeat;
+}
+
+// same rows, destinations and weights, element by element
+bool sameDemand(const pisa::sparseDemand& a, const pisa::sparseDemand& b) {
+    if (a.numVertices() != b.numVertices()
+        || !std::equal(a.offsets().begin(), a.offsets().end(), b.offsets().begin(), b.offsets().end())) {
+        return false;
+    }
+    return std::equal(a.entries().begin(), a.entries().end(), b.entries().begin(), b.entries().end(),
+                      [](const pisa::demandEntry& x, const pisa::demandEntry& y) {
+                          return x.dst == y.dst && x.weight == y.weight;
+                      });
+}
+
+int main (int argc, char* argv[]) {
+    argparse::ArgumentParser parser("parse_bench");
+
+    std::vector<std::string> files;
+    parser.add_argument("files")
+        .nargs(argparse::nargs_pattern::any)
+        .store_into(files)
+        .help("request traces to parse (default: every file in datasets/tor)");
+
+    int repeat;
+    parser.add_argument("--repeat")
+        .default_value(50)
+        .store_into(repeat)
+        .help("parses per measurement");
+
+    try {
+        parser.parse_args(argc, argv);
+    } catch (const std::exception& err) {
+        std::cerr << err.what() << std::endl;
+        std::cerr << parser;
+        std::exit(1);
+    }
+
+    if (files.empty()) {
+        for (const auto& entry : std::filesystem::directory_iterator("datasets/tor")) {
+            files.push_back(entry.path().string());
+        }
+        std::sort(files.begin(), files.end());
+    }
+
+    std::cout << "file,bytes,parser,seconds,MB/s,speedup\n";
+    for (const auto& path : files) {
+        // the file is read once up front so only parsing is timed
+        const std::string text = pisa::readTextFile(path);
+        const double megabytes = text.size() / 1e6;
+
+        pisa::sparseDemand streamDemand, serialDemand, parallelDemand;
+        double streams = secondsPerParse(repeat, [&] { return parseWithStreams(text); }, streamDemand);
+        double serial = secondsPerParse(repeat, [&] {
+            return pisa::parseDemandText(text, pisa::textFormat::requests, false);
+        }, serialDemand);
+        double parallel = secondsPerParse(repeat, [&] {
+            return pisa::parseDemandText(text, pisa::textFormat::requests, true);
+        }, parallelDemand);
+
+        if (!sameDemand(serialDemand, streamDemand) || !sameDemand(parallelDemand, streamDemand)) {
+            std::cerr << path << ": parsers disagree on the demand" << std::endl;
+            return 1;
+        }
+
+        for (const auto& [name, secs] : {std::pair{"streams", streams}, {"from_chars", serial}, {"from_chars-parallel", parallel}}) {
+            std::cout << path << "," << text.size() << "," << name << "," << secs << ","
+                      << megabytes / secs << "," << streams / secs << "\n";
+        }
+    }
+}
@@ -10,21 +10,44 @@
 
 #include <algorithm.hh>
 #include <argparse/argparse.hh>
+#include <core/batchRunner.hh>
 #include <core/bisectionRunRecord.hh>
+#include <core/engineRegistry.hh>
 #include <core/logLevel.hh>
 #include <treebuilders/optbst.hh>
 #include <treebuilders/greedy.hh>
 #include <recursiveGraphBisection.hh>
+#include <util/datasetCache.hh>
 #include <util/forwardIndex.hh>
 #include <util/forwardIndexFactory.hh>
+#include <util/sparseDemand.hh>
+#include <util/traceParser.hh>
+#include <util/treeCost.hh>
 
 struct Options {
     std::string algorithm;
-    size_t maxDepth;
+    size_t maxDepth = 0;
     int maxIterations;
     std::string datasetName;
     std::string outputDirectory;
+    std::vector<std::string> algorithms;
+    std::vector<int> depths;
+    std::vector<int> iterations;
+    std::vector<std::string> datasets;
+    std::string jobFile;
+    bool datasetCache = false;
     bool verbose = false;
+    bool incrementalGains = false;
+    bool vectorisedGains = false;
+    bool partitionTermGains = false;
+    long localTermThreshold = 0;
+    bool childSubindexes = false;
+    double minPassGain = 0.0;
+    std::string selection = "sort";
+    long parallelSortThreshold = 1 << 15;
+    long parallelThreshold = 1 << 12;
+    int threads = 0;
+    bool serialLegacy = false;
 };
 
 void parseArguments(int argc, char* argv[], Options& options) {
@@ -32,7 +55,7 @@ void parseArguments(int argc, char* argv[], Options& options) {
 
     parser.add_argument("--algorithm")
         .store_into(options.algorithm)
-        .help("the name of the algorithm (mloga or loggap)");
+        .help("the registered engine to run (noop, mloga, loggap, basic, onehop or mloggap)");
 
     parser.add_argument("--max-depth")
         .store_into(options.maxDepth)
@@ -52,11 +75,95 @@ void parseArguments(int argc, char* argv[], Options& options) {
         .store_into(options.outputDirectory)
         .help("the name of the output directory");
 
+    parser.add_argument("--algorithms")
+        .nargs(argparse::nargs_pattern::at_least_one)
+        .store_into(options.algorithms)
+        .help("batch: engines to run (defaults to --algorithm)");
+
+    parser.add_argument("--depths")
+        .nargs(argparse::nargs_pattern::at_least_one)
+        .store_into(options.depths)
+        .help("batch: max depths to run (defaults to --max-depth)");
+
+    parser.add_argument("--iterations")
+        .nargs(argparse::nargs_pattern::at_least_one)
+        .store_into(options.iterations)
+        .help("batch: max iterations to run (defaults to --max-iterations)");
+
+    parser.add_argument("--datasets")
+        .nargs(argparse::nargs_pattern::at_least_one)
+        .store_into(options.datasets)
+        .help("batch: datasets to run on (defaults to --dataset-name)");
+
+    parser.add_argument("--job-file")
+        .store_into(options.jobFile)
+        .help("batch: file of dataset,algorithm,max-iterations,max-depth lines, run instead of the grid");
+
+    parser.add_argument("--dataset-cache")
+        .flag()
+        .store_into(options.datasetCache)
+        .help("map <dataset>.bpds if it is up to date, else parse the trace and write it (with both forward indexes)");
+
     parser.add_argument("--verbose")
         .flag()
         .store_into(options.verbose)
         .help("enable verbose (debug-level) output");
 
+    parser.add_argument("--incremental-gains")
+        .flag()
+        .store_into(options.incrementalGains)
+        .help("only recompute gains of vertices touched by the last swap and stop at convergence");
+
+    parser.add_argument("--vectorised-gains")
+        .flag()
+        .store_into(options.vectorisedGains)
+        .help("compute gains with the table-driven SIMD kernel");
+
+    parser.add_argument("--partition-term-gains")
+        .flag()
+        .store_into(options.partitionTermGains)
+        .help("precompute a dense per-partition term gain table each pass instead of caching gains");
+
+    parser.add_argument("--local-term-threshold")
+        .default_value(0L)
+        .store_into(options.localTermThreshold)
+        .help("subtrees with at most this many vertices recurse on a locally renumbered index (0 = off)");
+
+    parser.add_argument("--child-subindexes")
+        .flag()
+        .store_into(options.childSubindexes)
+        .help("rebuild a compact forward index for each half after every level, dropping single-vertex terms");
+
+    parser.add_argument("--min-pass-gain")
+        .default_value(0.0)
+        .store_into(options.minPassGain)
+        .help("stop iterating a level once a pass gains less than this");
+
+    parser.add_argument("--selection")
+        .default_value(std::string("sort"))
+        .store_into(options.selection)
+        .help("how halves are ordered each pass (sort or candidates)");
+
+    parser.add_argument("--parallel-sort-threshold")
+        .default_value(1L << 15)
+        .store_into(options.parallelSortThreshold)
+        .help("halves at least this large are sorted with tbb::parallel_sort");
+
+    parser.add_argument("--parallel-threshold")
+        .default_value(1L << 12)
+        .store_into(options.parallelThreshold)
+        .help("partitions at least this large compute degrees and gains in parallel");
+
+    parser.add_argument("--threads")
+        .default_value(0)
+        .store_into(options.threads)
+        .help("size of the task arena the jobs run in (0 = all cores)");
+
+    parser.add_argument("--serial-legacy")
+        .flag()
+        .store_into(options.serialLegacy)
+        .help("recurse serially in the legacy engines (basic, onehop, mloggap)");
+
     try {
         parser.parse_args(argc, argv);
     } catch (const std::exception& err) {
@@ -67,120 +174,56 @@ void parseArguments(int argc, char* argv[], Options& options) {
 
 }
 
-std::vector<std::vector<double>>
-loadDataset(const std::string& filename) {
-    std::ifstream file(filename);
-
-    std::cout << "Loading dataset from: " << filename << std::endl;
-    if (!file.is_open()) {
-        throw std::runtime_error("Could not open file: " + filename);
-    }
-
-    std::string line;
-    size_t numVertices = 0;
-    size_t numRequests = 0;
-
-    // Read first line with numVertices and numRequests
-    if (std::getline(file, line)) {
-        std::stringstream ss(line);
-        std::string token;
-        if (std::getline(ss, token, ',')) {
-            numVertices = std::stoul(token);
-        }
-        if (std::getline(ss, token, ',')) {
-            numRequests = std::stoul(token);
-        }
-    } else {
-        throw std::runtime_error("File is empty or invalid format.");
-    }
-
-    // Initialize demand matrix with zeros
-    std::vector<std::vector<double>> demandMatrix(numVertices, std::vector<double>(numVertices, 0.0));
-
-    for (size_t i = 0; i < numRequests; ++i) {
-        if (!std::getline(file, line)) {
-            throw std::runtime_error("Not enough lines for the specified number of requests.");
-        }
-        
-        std::stringstream ss(line);
-        std::string token;
-        int src = -1, dst = -1;
-
-        if (std::getline(ss, token, ',')) {
-            src = std::stoi(token);
-        }
-        if (std::getline(ss, token, ',')) {
-            dst = std::stoi(token);
-        }
-
-        if (src >= 0 && dst >= 0 && src < numVertices && dst < numVertices) {
-            demandMatrix[src][dst]++;
-            demandMatrix[dst][src]++; // Assuming undirected graph
-        } else {
-            throw std::runtime_error("Invalid vertex index in: " + line);
-        }
-    }
-
-    return demandMatrix;
-}
-
-pisa::verticeRange<std::vector<uint32_t>::iterator> createVerticeRange(
-    std::vector<uint32_t>& vertices,
-    const pisa::forwardIndex& fwdIndex,
-    std::vector<double>& gains
-) {
-    return pisa::verticeRange(vertices.begin(), vertices.end(), std::cref(fwdIndex), std::ref(gains));
-}
-
-double computeBalancedBinaryTreeCostAfterReordering(
-    std::vector<uint32_t> vertices,
-    const std::vector<std::vector<double>>& demandMatrix
-) {
-    uint32_t nVertices = vertices.size();
-    auto reassignedDemandMatrix = reconfigureDemandMatrix(vertices, demandMatrix);
-
-    // Build tree with canonical 0..n-1 ordering (positions, not original IDs)
-    std::vector<uint32_t> canonicalOrder(nVertices);
-    std::iota(canonicalOrder.begin(), canonicalOrder.end(), 0);
-
-    std::vector<std::vector<uint32_t>> tree(nVertices, std::vector<uint32_t>());
-    buildBalancedBinaryTree(canonicalOrder, tree, {0, nVertices}, -1);
-
-    return treeCost(tree, reassignedDemandMatrix);
-}
-
 int main (int argc, char* argv[]) {
     Options options;
     parseArguments(argc, argv, options);
 
     g_logLevel = options.verbose ? LogLevel::Debug : LogLevel::Info;
 
-    const auto& demandMatrix = loadDataset(options.datasetName);
-    log(LogLevel::Info) << "Loaded dataset with " << demandMatrix.size() << " vertices." << std::endl;
-
-    uint32_t numVertices = demandMatrix.size();
-    std::vector<uint32_t> vertices(numVertices);
-    std::iota(vertices.begin(), vertices.end(), 0);
-
-    log(LogLevel::Debug) << "Running algorithm: " << options.algorithm
-                << " with max depth: " << options.maxDepth
-                << " and max iterations: " << options.maxIterations << std::endl;
-
-    pisa::forwardIndex fwdIndex;
-    if (options.algorithm == "loggap") {
-        log(LogLevel::Info) << "Creating forward index for LogGap..." << std::endl;
-        fwdIndex = pisa::createLogGapForwardIndex(demandMatrix);
-    } else if (options.algorithm == "mloga") {
-        log(LogLevel::Info) << "Creating forward index for MLOGA..." << std::endl;
-        fwdIndex = pisa::createMlogaForwardIndex(demandMatrix);
+    // a single run is the one-job grid of --algorithm, --max-depth, --max-iterations
+    // and --dataset-name; each list flag replaces its single-value counterpart
+    std::vector<BatchJob_t> jobs;
+    if (!options.jobFile.empty()) {
+        jobs = readJobFile(options.jobFile);
     } else {
-        throw std::runtime_error("Unknown algorithm: " + options.algorithm);
+        jobs = expandJobGrid(
+            options.algorithms.empty() ? std::vector<std::string>{ options.algorithm } : options.algorithms,
+            options.depths.empty() ? std::vector<int>{ static_cast<int>(options.maxDepth) } : options.depths,
+            options.iterations.empty() ? std::vector<int>{ options.maxIterations } : options.iterations,
+            options.datasets.empty() ? std::vector<std::string>{ options.datasetName } : options.datasets
+        );
     }
-    std::vector<double> gains(numVertices, 0.0);
-    auto verticesRange = createVerticeRange(vertices, fwdIndex, gains);
 
-    pisa::recursiveGraphBisection(verticesRange, options.maxDepth, options.maxIterations, options.maxDepth - 6, nullptr);
+    EngineOptions_t engineOptions;
+    engineOptions.threads = options.threads;
+    engineOptions.parallelize = !options.serialLegacy;
+
+    pisa::bisectionConfig& config = engineOptions.bisection;
+    config.incremental_gains = options.incrementalGains;
+    config.vectorised_gains = options.vectorisedGains;
+    config.partition_term_gains = options.partitionTermGains;
+    config.local_term_threshold = options.localTermThreshold;
+    config.child_subindexes = options.childSubindexes;
+    config.min_pass_gain = options.minPassGain;
+    config.parallel_sort_threshold = options.parallelSortThreshold;
+    config.parallel_gain_threshold = options.parallelThreshold;
+    if (options.selection == "candidates") {
+        config.selection = pisa::selectionStrategy::candidatesOnly;
+    } else if (options.selection != "sort") {
+        throw std::runtime_error("Unknown selection strategy: " + options.selection);
+    }
 
-    double totalCost = computeBalancedBinaryTreeCostAfterReordering(vertices, demandMatrix);
-    log(LogLevel::Info) << "Total cost after reordering: " << totalCost << std::endl;
+    // a .bpds cache given as --dataset-name is always mapped, with or without --dataset-cache
+    auto parseTrace = [](const std::string& name) {
+        log(LogLevel::Info) << "Loading dataset from: " << name << std::endl;
+        return pisa::parseDemandFile(name, pisa::textFormat::requests);
+    };
+    auto load = [&](const std::string& name) {
+        return pisa::loadWithCache(name, pisa::textFormat::requests, options.datasetCache, true, parseTrace);
+    };
+    size_t failed = runBatch(jobs, load, engineOptions, options.outputDirectory);
+    if (failed > 0) {
+        log(LogLevel::Error) << failed << " of " << jobs.size() << " jobs failed" << std::endl;
+        return 1;
+    }
 }
@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include <tbb/global_control.h>
+
+#include "core/batchRunner.hh"
+
+namespace fs = std::filesystem;
+
+// ── helpers ──────────────────────────────────────────────────────────────────
+
+static pisa::sparseDemand randomDemand(uint32_t n, uint32_t requests, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<uint32_t> vertex(0, n - 1);
+    pisa::edgeAccumulator edges(n);
+    for (uint32_t r = 0; r < requests; ++r) {
+        uint32_t src = vertex(rng);
+        uint32_t dst = vertex(rng);
+        if (src != dst) {
+            edges.addUndirected(src, dst);
+        }
+    }
+    return edges.build();
+}
+
+class BatchRunnerTest : public ::testing::Test {
+protected:
+    fs::path tmpDir_;
+
+    void SetUp() override {
+        tmpDir_ = fs::temp_directory_path() / "batch_test_";
+        tmpDir_ += std::to_string(::getpid());
+        fs::create_directories(tmpDir_);
+    }
+
+    void TearDown() override {
+        fs::remove_all(tmpDir_);
+    }
+
+    std::vector<std::string> readLines(const fs::path& path) {
+        std::ifstream f(path);
+        std::vector<std::string> lines;
+        std::string line;
+        while (std::getline(f, line)) {
+            lines.push_back(line);
+        }
+        return lines;
+    }
+};
+
+// ── job lists ────────────────────────────────────────────────────────────────
+
+TEST(BatchJobTest, ExpandJobGrid_AlgorithmOutermostDatasetInnermost) {
+    auto jobs = expandJobGrid({"mloga", "basic"}, {2, 4}, {10}, {"a", "b"});
+    ASSERT_EQ(jobs.size(), 8u);
+    EXPECT_EQ(jobs[0].algorithm, "mloga");
+    EXPECT_EQ(jobs[0].maxDepth, 2);
+    EXPECT_EQ(jobs[0].datasetName, "a");
+    EXPECT_EQ(jobs[1].datasetName, "b");
+    EXPECT_EQ(jobs[2].maxDepth, 4);
+    EXPECT_EQ(jobs[4].algorithm, "basic");
+    EXPECT_EQ(jobs[7].maxIterations, 10);
+}
+
+TEST_F(BatchRunnerTest, ReadJobFile_SkipsCommentsAndBlankLines) {
+    fs::path path = tmpDir_ / "jobs.txt";
+    std::ofstream(path) << "# dataset,algorithm,iterations,depth\n"
+                        << "weights/tor,mloga,20,6\n"
+                        << "\n"
+                        << "weights/tor,onehop,5,3\n";
+
+    auto jobs = readJobFile(path.string());
+    ASSERT_EQ(jobs.size(), 2u);
+    EXPECT_EQ(jobs[0].datasetName, "weights/tor");
+    EXPECT_EQ(jobs[0].algorithm, "mloga");
+    EXPECT_EQ(jobs[0].maxIterations, 20);
+    EXPECT_EQ(jobs[0].maxDepth, 6);
+    EXPECT_EQ(jobs[1].algorithm, "onehop");
+}
+
+TEST_F(BatchRunnerTest, ReadJobFile_RejectsShortLine) {
+    fs::path path = tmpDir_ / "jobs.txt";
+    std::ofstream(path) << "weights/tor,mloga,20\n";
+    EXPECT_THROW(readJobFile(path.string()), std::runtime_error);
+}
+
+// ── runBatch ─────────────────────────────────────────────────────────────────
+
+TEST_F(BatchRunnerTest, RunBatch_LoadsEachDatasetOnceAndWritesEveryRow) {
+    tbb::global_control workers(tbb::global_control::max_allowed_parallelism, 4);
+    std::atomic<int> loads{0};
+    auto load = [&](const std::string& name) {
+        loads++;
+        return randomDemand(64, 400, name == "a" ? 1 : 2);
+    };
+
+    auto jobs = expandJobGrid({"mloga", "loggap", "onehop", "mloggap"}, {3, 5}, {10}, {"a", "b"});
+    EngineOptions_t options;
+    options.threads = 4;
+    size_t failed = runBatch(jobs, load, options, tmpDir_.string());
+
+    EXPECT_EQ(failed, 0u);
+    EXPECT_EQ(loads, 2);
+    EXPECT_EQ(readLines(tmpDir_ / "result.csv").size(), jobs.size());
+    // metrics.out carries one header line plus one row per job
+    EXPECT_EQ(readLines(tmpDir_ / "metrics.out").size(), jobs.size() + 1);
+}
+
+TEST_F(BatchRunnerTest, RunBatch_MatchesIndividualRuns) {
+    tbb::global_control workers(tbb::global_control::max_allowed_parallelism, 4);
+    auto demand = randomDemand(128, 1000, 3);
+    auto load = [&](const std::string&) { return demand; };
+
+    EngineOptions_t options;
+    options.threads = 4;
+    auto jobs = expandJobGrid({"mloga", "basic"}, {4}, {10}, {"d"});
+    runBatch(jobs, load, options, tmpDir_.string());
+
+    // a pisa run is deterministic and the legacy merge keeps serial order, so each
+    // row's cost must equal that of the same job run on its own
+    EngineInput_t input(randomDemand(128, 1000, 3));
+    std::vector<std::string> expected;
+    for (const auto& job : jobs) {
+        RunConfig config;
+        config.maxIterations = job.maxIterations;
+        BisectionRunRecord record(config);
+        options.maxDepth = job.maxDepth;
+        options.maxIterations = job.maxIterations;
+        auto vertices = runEngine(findEngine(job.algorithm), input, options, record);
+        std::ostringstream row;
+        row << job.datasetName << "," << job.algorithm << "," << job.maxIterations << ","
+            << job.maxDepth << "," << pisa::balancedTreeCost(vertices, input.demand()) << ",0";
+        expected.push_back(row.str());
+    }
+
+    auto rows = readLines(tmpDir_ / "result.csv");
+    std::sort(rows.begin(), rows.end());
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(rows, expected);
+}
+
+TEST_F(BatchRunnerTest, RunBatch_UnknownAlgorithmThrowsBeforeLoading) {
+    int loads = 0;
+    auto load = [&](const std::string&) { loads++; return randomDemand(8, 10, 4); };
+    auto jobs = expandJobGrid({"mloga", "quicksort"}, {2}, {5}, {"a"});
+    EXPECT_THROW(runBatch(jobs, load, EngineOptions_t{}, tmpDir_.string()), std::runtime_error);
+    EXPECT_EQ(loads, 0);
+}
@@ -172,6 +172,35 @@ TEST(BisectionRunRecordTest, Reset_AllowsNewSamplesAfterReset) {
     EXPECT_DOUBLE_EQ(record.averageCostGain(), 3.0);
 }
 
+// ── merge ─────────────────────────────────────────────────────────────────────
+
+TEST(BisectionRunRecordTest, Merge_AppendsSamples) {
+    BisectionRunRecord record(makeConfig(5));
+    record.recordCostGain(1.0);
+    record.recordIterationCount(5);
+
+    BisectionRunRecord sub(RunConfig{});
+    sub.recordCostGain(3.0);
+    sub.recordSwappedPairs(4);
+    sub.recordIterationCount(5);
+    sub.recordIterationCount(2);
+
+    record.merge(sub);
+
+    EXPECT_DOUBLE_EQ(record.averageCostGain(),      2.0);
+    EXPECT_DOUBLE_EQ(record.averageSwappedPairs(),  4.0);
+    EXPECT_EQ(record.maxIterationHitCount(),        2);
+}
+
+TEST(BisectionRunRecordTest, Merge_KeepsOwnConfig) {
+    BisectionRunRecord record(makeConfig(7, 2));
+    BisectionRunRecord sub(makeConfig(1, 1));
+    record.merge(sub);
+
+    EXPECT_EQ(record.config().maxIterations, 7);
+    EXPECT_EQ(record.config().maxDepth,      2);
+}
+
 // ── appendToCsv ───────────────────────────────────────────────────────────────
 
 class BisectionRunRecordFileTest : public ::testing::Test {
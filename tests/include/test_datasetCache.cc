@@ -0,0 +1,270 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "util/datasetCache.hh"
+
+namespace fs = std::filesystem;
+
+// ── helpers ──────────────────────────────────────────────────────────────────
+
+static pisa::sparseDemand randomDemand(uint32_t n, uint32_t requests, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<uint32_t> vertex(0, n - 1);
+    std::uniform_real_distribution<double> weight(0.5, 4.0);
+    pisa::edgeAccumulator edges(n);
+    for (uint32_t r = 0; r < requests; ++r) {
+        edges.add(vertex(rng), vertex(rng), weight(rng));
+    }
+    return edges.build();
+}
+
+static void expectSameDemand(const pisa::sparseDemand& a, const pisa::sparseDemand& b) {
+    ASSERT_EQ(a.numVertices(), b.numVertices());
+    ASSERT_EQ(a.numEntries(), b.numEntries());
+    for (uint32_t v = 0; v < a.numVertices(); ++v) {
+        auto ra = a.row(v);
+        auto rb = b.row(v);
+        ASSERT_EQ(ra.size(), rb.size());
+        for (std::size_t i = 0; i < ra.size(); ++i) {
+            EXPECT_EQ(ra.begin()[i].dst, rb.begin()[i].dst);
+            EXPECT_EQ(ra.begin()[i].weight, rb.begin()[i].weight);
+        }
+    }
+}
+
+static void expectSameIndex(const pisa::forwardIndex& a, const pisa::forwardIndex& b) {
+    ASSERT_EQ(a.documentCount(), b.documentCount());
+    EXPECT_EQ(a.termCount(), b.termCount());
+    for (uint32_t d = 0; d < a.documentCount(); ++d) {
+        EXPECT_EQ(a.terms(d), b.terms(d));
+    }
+}
+
+class DatasetCacheTest : public ::testing::Test {
+protected:
+    fs::path tmpDir_;
+
+    void SetUp() override {
+        tmpDir_ = fs::temp_directory_path() / "dscache_test_";
+        tmpDir_ += std::to_string(::getpid());
+        fs::create_directories(tmpDir_);
+    }
+
+    void TearDown() override {
+        fs::remove_all(tmpDir_);
+    }
+};
+
+// ── round trip ───────────────────────────────────────────────────────────────
+
+TEST_F(DatasetCacheTest, RoundTrip_DemandOnly) {
+    pisa::datasetBundle bundle(randomDemand(50, 400, 1));
+    std::string path = (tmpDir_ / "d.bpds").string();
+    pisa::writeDatasetCache(path, bundle);
+
+    ASSERT_TRUE(pisa::isDatasetCache(path));
+    auto mapped = pisa::mapDatasetCache(path);
+    expectSameDemand(mapped.demand, bundle.demand);
+    EXPECT_FALSE(mapped.mlogaIndex.has_value());
+    EXPECT_FALSE(mapped.logGapIndex.has_value());
+}
+
+TEST_F(DatasetCacheTest, RoundTrip_WithForwardIndexes) {
+    pisa::datasetBundle bundle(randomDemand(80, 600, 2));
+    bundle.mlogaIndex = pisa::createMlogaForwardIndex(bundle.demand);
+    bundle.logGapIndex = pisa::createLogGapForwardIndex(bundle.demand);
+    std::string path = (tmpDir_ / "d.bpds").string();
+    pisa::writeDatasetCache(path, bundle);
+
+    auto mapped = pisa::mapDatasetCache(path);
+    expectSameDemand(mapped.demand, bundle.demand);
+    ASSERT_TRUE(mapped.mlogaIndex && mapped.logGapIndex);
+    expectSameIndex(*mapped.mlogaIndex, *bundle.mlogaIndex);
+    expectSameIndex(*mapped.logGapIndex, *bundle.logGapIndex);
+}
+
+TEST_F(DatasetCacheTest, RoundTrip_EmptyDemand) {
+    pisa::datasetBundle bundle(pisa::edgeAccumulator(0).build());
+    std::string path = (tmpDir_ / "empty.bpds").string();
+    pisa::writeDatasetCache(path, bundle);
+
+    auto mapped = pisa::mapDatasetCache(path);
+    EXPECT_EQ(mapped.demand.numVertices(), 0u);
+    EXPECT_EQ(mapped.demand.numEntries(), 0u);
+}
+
+TEST_F(DatasetCacheTest, MappedDemand_OutlivesOtherCopies) {
+    std::string path = (tmpDir_ / "d.bpds").string();
+    pisa::writeDatasetCache(path, pisa::datasetBundle(randomDemand(20, 100, 3)));
+
+    pisa::sparseDemand kept;
+    {
+        auto mapped = pisa::mapDatasetCache(path);
+        kept = mapped.demand;
+        EXPECT_EQ(kept.entries().data(), mapped.demand.entries().data());
+    }
+    fs::remove(path);
+    expectSameDemand(kept, randomDemand(20, 100, 3));
+}
+
+// ── validation ───────────────────────────────────────────────────────────────
+
+TEST_F(DatasetCacheTest, TextFile_IsNotACache) {
+    fs::path path = tmpDir_ / "trace.txt";
+    std::ofstream(path) << "4,1\n0,1\n";
+    EXPECT_FALSE(pisa::isDatasetCache(path.string()));
+    EXPECT_FALSE(pisa::isDatasetCache((tmpDir_ / "missing").string()));
+}
+
+TEST_F(DatasetCacheTest, TruncatedCache_Throws) {
+    std::string path = (tmpDir_ / "d.bpds").string();
+    pisa::writeDatasetCache(path, pisa::datasetBundle(randomDemand(30, 200, 4)));
+    fs::resize_file(path, fs::file_size(path) - 8);
+    EXPECT_THROW(pisa::mapDatasetCache(path), std::runtime_error);
+}
+
+TEST_F(DatasetCacheTest, NonMonotoneOffsets_Throw) {
+    std::string path = (tmpDir_ / "d.bpds").string();
+    pisa::writeDatasetCache(path, pisa::datasetBundle(randomDemand(30, 200, 4)));
+    pisa::datasetCache::header h{};
+    ASSERT_TRUE(pisa::datasetCache::readHeader(path, h));
+
+    // offsets[1] beyond offsets[2]: rows would overlap
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    uint32_t huge = static_cast<uint32_t>(h.numEntries);
+    file.seekp(static_cast<std::streamoff>(h.offsetsPos + sizeof(uint32_t)));
+    file.write(reinterpret_cast<const char*>(&huge), sizeof(huge));
+    file.close();
+    EXPECT_THROW(pisa::mapDatasetCache(path), std::runtime_error);
+}
+
+TEST_F(DatasetCacheTest, OutOfRangeEntry_Throws) {
+    std::string path = (tmpDir_ / "d.bpds").string();
+    pisa::writeDatasetCache(path, pisa::datasetBundle(randomDemand(30, 200, 4)));
+    pisa::datasetCache::header h{};
+    ASSERT_TRUE(pisa::datasetCache::readHeader(path, h));
+
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    uint32_t dst = 30;
+    file.seekp(static_cast<std::streamoff>(h.entriesPos));
+    file.write(reinterpret_cast<const char*>(&dst), sizeof(dst));
+    file.close();
+    EXPECT_THROW(pisa::mapDatasetCache(path), std::runtime_error);
+}
+
+TEST_F(DatasetCacheTest, UnsortedRow_Throws) {
+    std::string path = (tmpDir_ / "d.bpds").string();
+    pisa::writeDatasetCache(path, pisa::datasetBundle(randomDemand(30, 200, 4)));
+    pisa::datasetCache::header h{};
+    ASSERT_TRUE(pisa::datasetCache::readHeader(path, h));
+    auto demand = randomDemand(30, 200, 4);
+    uint32_t row = 0;
+    while (demand.row(row).size() < 2) ++row;
+    uint32_t first = demand.offsets()[row];
+
+    // swap the first two dsts of the row
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    uint32_t a = demand.entries()[first + 1].dst, b = demand.entries()[first].dst;
+    file.seekp(static_cast<std::streamoff>(h.entriesPos + first * sizeof(pisa::demandEntry)));
+    file.write(reinterpret_cast<const char*>(&a), sizeof(a));
+    file.seekp(static_cast<std::streamoff>(h.entriesPos + (first + 1) * sizeof(pisa::demandEntry)));
+    file.write(reinterpret_cast<const char*>(&b), sizeof(b));
+    file.close();
+    EXPECT_THROW(pisa::mapDatasetCache(path), std::runtime_error);
+}
+
+TEST_F(DatasetCacheTest, IndexWithFewerDocumentsThanVertices_Throws) {
+    // a well-formed index, but of a smaller demand
+    pisa::datasetBundle bundle(randomDemand(30, 200, 4));
+    bundle.mlogaIndex = pisa::createMlogaForwardIndex(randomDemand(20, 150, 5));
+    std::string path = (tmpDir_ / "d.bpds").string();
+    pisa::writeDatasetCache(path, bundle);
+    EXPECT_THROW(pisa::mapDatasetCache(path), std::runtime_error);
+}
+
+TEST_F(DatasetCacheTest, OutOfRangeIndexTerm_Throws) {
+    pisa::datasetBundle bundle(randomDemand(30, 200, 4));
+    bundle.mlogaIndex = pisa::createMlogaForwardIndex(bundle.demand);
+    std::string path = (tmpDir_ / "d.bpds").string();
+    pisa::writeDatasetCache(path, bundle);
+    pisa::datasetCache::header h{};
+    ASSERT_TRUE(pisa::datasetCache::readHeader(path, h));
+    ASSERT_GT(h.mloga.numTerms, 0u);
+
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    uint32_t term = static_cast<uint32_t>(h.mloga.termCount);
+    file.seekp(static_cast<std::streamoff>(h.mloga.termsPos));
+    file.write(reinterpret_cast<const char*>(&term), sizeof(term));
+    file.close();
+    EXPECT_THROW(pisa::mapDatasetCache(path), std::runtime_error);
+}
+
+// ── loadWithCache ────────────────────────────────────────────────────────────
+
+TEST_F(DatasetCacheTest, LoadWithCache_ParsesOnceThenMaps) {
+    fs::path trace = tmpDir_ / "trace.txt";
+    std::ofstream(trace) << "unused";
+    int parses = 0;
+    auto parse = [&](const std::string&) { parses++; return randomDemand(40, 300, 5); };
+
+    auto first = pisa::loadWithCache(trace.string(), pisa::textFormat::requests, true, true, parse);
+    auto second = pisa::loadWithCache(trace.string(), pisa::textFormat::requests, true, true, parse);
+
+    EXPECT_EQ(parses, 1);
+    EXPECT_TRUE(fs::exists(trace.string() + pisa::datasetCache::extension));
+    expectSameDemand(second.demand, first.demand);
+    ASSERT_TRUE(second.mlogaIndex.has_value());
+    expectSameIndex(*second.mlogaIndex, *first.mlogaIndex);
+}
+
+TEST_F(DatasetCacheTest, LoadWithCache_StaleCacheIsRebuilt) {
+    fs::path trace = tmpDir_ / "trace.txt";
+    std::ofstream(trace) << "unused";
+    int parses = 0;
+    auto parse = [&](const std::string&) { parses++; return randomDemand(10, 50, 6); };
+
+    pisa::loadWithCache(trace.string(), pisa::textFormat::requests, true, false, parse);
+    fs::last_write_time(trace, fs::last_write_time(trace.string() + pisa::datasetCache::extension) + std::chrono::seconds(5));
+    pisa::loadWithCache(trace.string(), pisa::textFormat::requests, true, false, parse);
+    EXPECT_EQ(parses, 2);
+}
+
+TEST_F(DatasetCacheTest, LoadWithCache_DisabledNeverWrites) {
+    fs::path trace = tmpDir_ / "trace.txt";
+    std::ofstream(trace) << "unused";
+    pisa::loadWithCache(trace.string(), pisa::textFormat::requests, false, true, [](const std::string&) { return randomDemand(10, 50, 7); });
+    EXPECT_FALSE(fs::exists(trace.string() + pisa::datasetCache::extension));
+}
+
+TEST_F(DatasetCacheTest, LoadWithCache_OtherFormatIsRebuilt) {
+    fs::path trace = tmpDir_ / "trace.txt";
+    std::ofstream(trace) << "unused";
+    int parses = 0;
+    auto parse = [&](const std::string&) { parses++; return randomDemand(10, 50, 8); };
+
+    pisa::loadWithCache(trace.string(), pisa::textFormat::requests, true, false, parse);
+    pisa::loadWithCache(trace.string(), pisa::textFormat::weights, true, false, parse);
+    pisa::loadWithCache(trace.string(), pisa::textFormat::weights, true, false, parse);
+    EXPECT_EQ(parses, 2);
+}
+
+TEST_F(DatasetCacheTest, LoadWithCache_OtherSourceSizeIsRebuilt) {
+    fs::path trace = tmpDir_ / "trace.txt";
+    std::ofstream(trace) << "unused";
+    int parses = 0;
+    auto parse = [&](const std::string&) { parses++; return randomDemand(10, 50, 9); };
+
+    pisa::loadWithCache(trace.string(), pisa::textFormat::requests, true, false, parse);
+    // a different source, yet older than the cache
+    auto cacheTime = fs::last_write_time(trace.string() + pisa::datasetCache::extension);
+    std::ofstream(trace) << "a longer unused trace";
+    fs::last_write_time(trace, cacheTime - std::chrono::seconds(5));
+    pisa::loadWithCache(trace.string(), pisa::textFormat::requests, true, false, parse);
+    EXPECT_EQ(parses, 2);
+}
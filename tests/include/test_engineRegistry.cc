@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <cstdint>
+#include <random>
+#include <algorithm>
+#include <numeric>
+
+#include "core/engineRegistry.hh"
+
+// ── helpers ──────────────────────────────────────────────────────────────────
+
+static pisa::sparseDemand randomDemand(uint32_t n, uint32_t requests, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<uint32_t> vertex(0, n - 1);
+    pisa::edgeAccumulator edges(n);
+    for (uint32_t r = 0; r < requests; ++r) {
+        uint32_t src = vertex(rng);
+        uint32_t dst = vertex(rng);
+        if (src != dst) {
+            edges.addUndirected(src, dst);
+        }
+    }
+    return edges.build();
+}
+
+static EngineOptions_t smallRunOptions() {
+    EngineOptions_t options;
+    options.maxDepth = 5;
+    options.maxIterations = 10;
+    options.threads = 1;
+    return options;
+}
+
+// ── registry ─────────────────────────────────────────────────────────────────
+
+TEST(EngineRegistryTest, FindEngine_KnowsEveryEngine) {
+    for (const char* name : {"noop", "mloga", "loggap", "basic", "onehop", "mloggap"}) {
+        EXPECT_EQ(findEngine(name).name, name);
+    }
+}
+
+TEST(EngineRegistryTest, FindEngine_UnknownNameThrows) {
+    EXPECT_THROW(findEngine("quicksort"), std::runtime_error);
+}
+
+TEST(EngineRegistryTest, EveryEngine_ProducesPermutation) {
+    EngineInput_t input(randomDemand(64, 500, 1));
+    for (const auto& engine : engineRegistry()) {
+        RunConfig config;
+        config.algorithm = engine.name;
+        config.maxIterations = 10;
+        BisectionRunRecord record(config);
+        auto vertices = runEngine(engine, input, smallRunOptions(), record);
+
+        auto sorted = vertices;
+        std::sort(sorted.begin(), sorted.end());
+        std::vector<uint32_t> identity(64);
+        std::iota(identity.begin(), identity.end(), 0);
+        EXPECT_EQ(sorted, identity) << engine.name;
+    }
+}
+
+TEST(EngineRegistryTest, Noop_KeepsIdentityOrder) {
+    EngineInput_t input(randomDemand(16, 50, 2));
+    RunConfig config;
+    BisectionRunRecord record(config);
+    auto vertices = runEngine(findEngine("noop"), input, smallRunOptions(), record);
+
+    std::vector<uint32_t> identity(16);
+    std::iota(identity.begin(), identity.end(), 0);
+    EXPECT_EQ(vertices, identity);
+}
+
+TEST(EngineRegistryTest, PisaEngine_ReportsToRecord) {
+    EngineInput_t input(randomDemand(64, 500, 3));
+    RunConfig config;
+    config.maxIterations = 10;
+    BisectionRunRecord record(config);
+    runEngine(findEngine("mloga"), input, smallRunOptions(), record);
+    EXPECT_GT(record.averageIterationCount(), 0.0);
+}
+
+// ── shared input ─────────────────────────────────────────────────────────────
+
+TEST(EngineInputTest, DerivedRepresentations_AreBuiltOnce) {
+    EngineInput_t input(randomDemand(32, 200, 4));
+    EXPECT_EQ(&input.mlogaIndex(), &input.mlogaIndex());
+    EXPECT_EQ(&input.bipartiteGraph(), &input.bipartiteGraph());
+    EXPECT_EQ(input.denseDemand(), input.demand().toDense());
+    EXPECT_EQ(input.logGapIndex().documentCount(), 32);
+}
@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 #include <vector>
 #include <cstdint>
+#include <algorithm>
 
 #include "util/forwardIndex.hh"
 
@@ -23,6 +24,15 @@ TEST(ForwardIndexTest, Construction_EmptyDocTerms) {
     EXPECT_EQ(idx.termCount(), 5);
 }
 
+TEST(ForwardIndexTest, Construction_FromFlattenedTerms) {
+    pisa::forwardIndex idx(std::vector<uint32_t>{4, 1, 2}, std::vector<uint32_t>{0, 2, 2, 3}, 5);
+    EXPECT_EQ(idx.termCount(), 5);
+    EXPECT_EQ(idx.documentCount(), 3);
+    EXPECT_EQ(idx.terms(0), (std::vector<uint32_t>{4, 1}));
+    EXPECT_TRUE(idx.terms(1).empty());
+    EXPECT_EQ(idx.terms(2), (std::vector<uint32_t>{2}));
+}
+
 // ── terms() ──────────────────────────────────────────────────────────────────
 
 TEST(ForwardIndexTest, Terms_SingleDocument) {
@@ -104,3 +114,43 @@ TEST(ForwardIndexTest, Terms_LargeDocument) {
     EXPECT_EQ(result[0], 0);
     EXPECT_EQ(result[999], 999);
 }
+
+// ── termsView() ──────────────────────────────────────────────────────────────
+
+TEST(ForwardIndexTest, TermsView_MatchesTerms) {
+    std::vector<std::vector<uint32_t>> docTerms = {
+        {0, 1, 2},
+        {},
+        {7, 9}
+    };
+    pisa::forwardIndex idx(docTerms, 10);
+
+    for (uint32_t d = 0; d < docTerms.size(); ++d) {
+        auto view = idx.termsView(d);
+        auto copy = idx.terms(d);
+        ASSERT_EQ(view.size(), copy.size());
+        EXPECT_EQ(view.empty(), copy.empty());
+        EXPECT_TRUE(std::equal(view.begin(), view.end(), copy.begin()));
+    }
+}
+
+TEST(ForwardIndexTest, TermsView_IsNonOwning) {
+    std::vector<std::vector<uint32_t>> docTerms = {{4, 5}, {6}};
+    pisa::forwardIndex idx(docTerms, 10);
+
+    auto v0 = idx.termsView(0);
+    auto v1 = idx.termsView(1);
+
+    // consecutive documents share one contiguous buffer
+    EXPECT_EQ(v0.end(), v1.begin());
+    EXPECT_EQ(v1[0], 6);
+}
+
+TEST(ForwardIndexTest, DocumentCount) {
+    pisa::forwardIndex empty;
+    EXPECT_EQ(empty.documentCount(), 0);
+
+    std::vector<std::vector<uint32_t>> docTerms = {{1}, {}, {2, 3}};
+    pisa::forwardIndex idx(docTerms, 4);
+    EXPECT_EQ(idx.documentCount(), 3);
+}
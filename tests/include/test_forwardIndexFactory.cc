@@ -227,3 +227,47 @@ TEST(MlogaForwardIndexTest, SparseMatrix_CorrectEdgeCount) {
     // Edges in different components have different IDs
     EXPECT_NE(idx.terms(0)[0], idx.terms(2)[0]);
 }
+
+// ── sparse overloads ────────────────────────────────────────────────────────
+
+static void expectSameIndex(const pisa::forwardIndex& a, const pisa::forwardIndex& b, uint32_t n) {
+    ASSERT_EQ(a.termCount(), b.termCount());
+    for (uint32_t d = 0; d < n; ++d) {
+        EXPECT_EQ(a.terms(d), b.terms(d)) << "document " << d;
+    }
+}
+
+TEST(SparseForwardIndexTest, LogGap_MatchesDense) {
+    std::vector<std::vector<double>> dm = {
+        {1.0, 3.0, 0.0, 0.0},
+        {0.0, 0.0, 2.0, 1e-11},
+        {5.0, 2.0, 0.0, 1.0},
+        {0.0, 0.0, 1.0, 0.0}
+    };
+    auto sparse = pisa::sparseDemand::fromDense(dm);
+    expectSameIndex(pisa::createLogGapForwardIndex(sparse), pisa::createLogGapForwardIndex(dm), 4);
+}
+
+TEST(SparseForwardIndexTest, Mloga_MatchesDense) {
+    std::vector<std::vector<double>> dm = {
+        {1.0, 3.0, 0.0, 0.0},
+        {0.0, 0.0, 2.0, 1e-11},
+        {5.0, 2.0, 0.0, 1.0},
+        {0.0, 0.0, 1.0, 0.0}
+    };
+    auto sparse = pisa::sparseDemand::fromDense(dm);
+    expectSameIndex(pisa::createMlogaForwardIndex(sparse), pisa::createMlogaForwardIndex(dm), 4);
+}
+
+TEST(SparseForwardIndexTest, Mloga_FromAccumulator_SharedEdgeId) {
+    pisa::edgeAccumulator acc(3);
+    acc.addUndirected(0, 2);
+    acc.addUndirected(2, 0);
+    auto idx = pisa::createMlogaForwardIndex(acc.build());
+
+    EXPECT_EQ(idx.termCount(), 1);
+    ASSERT_EQ(idx.terms(0).size(), 1);
+    ASSERT_EQ(idx.terms(2).size(), 1);
+    EXPECT_EQ(idx.terms(0)[0], idx.terms(2)[0]);
+    EXPECT_TRUE(idx.terms(1).empty());
+}
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <random>
+
+#include "util/gainKernel.hh"
+
+// ── helpers ──────────────────────────────────────────────────────────────────
+
+static double f(double d) { return d * std::log2(d + 1.0); }
+
+static double expb(double logn1, double logn2, double deg1, double deg2) {
+    return deg1 * logn1 - f(deg1) + deg2 * logn2 - f(deg2);
+}
+
+// ── moveGainTable ───────────────────────────────────────────────────────────
+
+TEST(MoveGainTableTest, DeltasMatchExpbDifference) {
+    pisa::bp::moveGainTable table(50);
+    const double logn1 = std::log2(37.0);
+    const double logn2 = std::log2(41.0);
+    for (uint32_t d1 = 1; d1 <= 50; ++d1) {
+        for (uint32_t d2 = 0; d2 + d1 <= 50; ++d2) {
+            double expected = expb(logn1, logn2, d1, d2) - expb(logn1, logn2, d1 - 1, d2 + 1);
+            double actual = (logn1 - logn2) + table.from_data()[d1] + table.to_data()[d2];
+            EXPECT_NEAR(actual, expected, 1e-9) << "d1=" << d1 << " d2=" << d2;
+        }
+    }
+}
+
+TEST(MoveGainTableTest, DefaultIsEmpty) {
+    pisa::bp::moveGainTable table;
+    EXPECT_TRUE(table.empty());
+    EXPECT_EQ(pisa::bp::moveGainTable(3).size(), 4);
+}
+
+// ── kernels ─────────────────────────────────────────────────────────────────
+
+class MoveDeltaKernelTest : public ::testing::TestWithParam<pisa::bp::gainKernelIsa> {};
+
+TEST_P(MoveDeltaKernelTest, MatchesScalarForAllLengths) {
+    auto isa = GetParam();
+    if (static_cast<int>(isa) > static_cast<int>(pisa::bp::detectGainKernelIsa())) {
+        GTEST_SKIP() << "ISA not supported on this CPU";
+    }
+
+    const uint32_t termCount = 300;
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<uint32_t> term(0, termCount - 1);
+    std::uniform_int_distribution<uint32_t> degree(0, 20);
+
+    degreeMap from(termCount);
+    degreeMap to(termCount);
+    from.clear();  // stamps from the first generation must not leak into the second
+    for (uint32_t t = 0; t < termCount; ++t) {
+        if (t % 3 != 0) from.set(t, 1 + degree(rng));
+        if (t % 4 != 0) to.set(t, degree(rng));
+    }
+    pisa::bp::moveGainTable table(64);
+    auto kernel = pisa::bp::moveDeltaKernel(isa);
+
+    for (uint32_t len = 0; len <= 40; ++len) {
+        std::vector<uint32_t> terms(len);
+        for (auto& t : terms) t = term(rng);
+        pisa::termSpan span(terms.data(), terms.data() + terms.size());
+
+        double expected = pisa::bp::moveDeltasScalar(span, from, to, table);
+        EXPECT_NEAR(kernel(span, from, to, table), expected, 1e-9) << "len=" << len;
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    AllIsas, MoveDeltaKernelTest,
+    ::testing::Values(
+        pisa::bp::gainKernelIsa::scalar,
+        pisa::bp::gainKernelIsa::avx2,
+        pisa::bp::gainKernelIsa::avx512
+    )
+);
@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "treebuilders/greedy.hh"
+
+// ── helpers ──────────────────────────────────────────────────────────────────
+
+// The greedy builder as it used to run: every one of the n^2 pairs sorted, a std::map of
+// leaves and an n x n distance table.
+static double referenceGreedy(const std::vector<std::vector<double>>& dm) {
+    int n = dm.size();
+    std::vector<std::vector<int>> dist(n, std::vector<int>(n, 0));
+    std::vector<int> pred(n, INF);
+    std::map<int, int> leafes;
+    double total = 0;
+
+    auto insert = [&](int v) {
+        if (pred[v] != INF) return;
+        if (leafes.empty()) {
+            pred[v] = -1;
+            leafes[v] = 2;
+            return;
+        }
+        double pMin = LINF;
+        int pIdx = -1;
+        for (const auto& [leaf, degree] : leafes) {
+            double c = 0;
+            for (int dst = 0; dst < n; ++dst) {
+                if (pred[dst] == INF) continue;
+                c += (dist[leaf][dst] + 1) * dm[v][dst];
+                c += (dist[leaf][dst] + 1) * dm[dst][v];
+            }
+            if (c < pMin) {
+                pMin = c;
+                pIdx = leaf;
+            }
+        }
+        if (--leafes[pIdx] == 0) leafes.erase(pIdx);
+        total += pMin;
+        leafes[v] = 2;
+        pred[v] = pIdx;
+        for (int dst = 0; dst < n; ++dst) {
+            if (pred[dst] == INF || dst == v) continue;
+            dist[v][dst] = dist[pIdx][dst] + 1;
+            dist[dst][v] = dist[dst][pIdx] + 1;
+        }
+    };
+
+    std::vector<std::pair<double, std::pair<int, int>>> queries;
+    for (int src = 0; src < n; ++src)
+        for (int dst = 0; dst < n; ++dst) queries.push_back({-dm[src][dst], {src, dst}});
+    std::sort(queries.begin(), queries.end());
+    for (const auto& q : queries) {
+        insert(q.second.first);
+        insert(q.second.second);
+    }
+    return total;
+}
+
+// sparse, asymmetric, with ties, self demands, fractional flows and isolated vertices
+static std::vector<std::vector<double>> randomDense(int n, int requests, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> vertex(0, n - 1);
+    std::vector<std::vector<double>> dm(n, std::vector<double>(n, 0.0));
+    for (int r = 0; r < requests; ++r) {
+        int src = vertex(rng) / 2;
+        int dst = vertex(rng);
+        dm[src][dst] += (rng() % 3 == 0) ? 0.25 * (1 + rng() % 5) : 1 + rng() % 3;
+    }
+    return dm;
+}
+
+// ── GrowingTree_t ────────────────────────────────────────────────────────────
+
+TEST(GreedyTest, GrowingTree_MatchesBfsDistances) {
+    const int n = 70;
+    std::mt19937 rng(1);
+    GrowingTree_t tree(n);
+    std::vector<std::vector<uint32_t>> adj(n);
+    tree.insert(0, -1);
+    for (int v = 1; v < n; ++v) {
+        int parent = rng() % v;
+        tree.insert(v, parent);
+        adj[v].push_back(parent);
+        adj[parent].push_back(v);
+    }
+    std::vector<std::vector<uint32_t>> dist(n, std::vector<uint32_t>(n, INF));
+    computeDistances(n, adj, dist);
+
+    for (int a = 0; a < n; ++a) {
+        for (int b = 0; b < n; ++b) {
+            EXPECT_EQ(static_cast<uint32_t>(tree.distance(a, b)), dist[a][b]) << a << "," << b;
+        }
+    }
+}
+
+// ── LeafSet_t ────────────────────────────────────────────────────────────────
+
+TEST(GreedyTest, LeafSet_DropsVertexAfterTwoChildren) {
+    LeafSet_t leafes(4);
+    leafes.add(0);
+    leafes.add(1);
+    leafes.add(2);
+    leafes.takeChild(0);
+    EXPECT_EQ(leafes.vertices().size(), 3u);
+    leafes.takeChild(0);
+    std::vector<int> left = leafes.vertices();
+    std::sort(left.begin(), left.end());
+    EXPECT_EQ(left, (std::vector<int>{1, 2}));
+}
+
+// ── greedyConstructor ────────────────────────────────────────────────────────
+
+TEST(GreedyTest, MatchesReference) {
+    for (unsigned seed = 0; seed < 25; ++seed) {
+        int n = 2 + 3 * seed;
+        auto dm = randomDense(n, 3 * n, seed);
+        EXPECT_EQ(greedyConstructor(n, dm), referenceGreedy(dm)) << "n=" << n;
+    }
+}
+
+TEST(GreedyTest, SparseOrdering_MatchesReorderedDense) {
+    auto dm = randomDense(60, 300, 40);
+    std::vector<uint32_t> vertices(60);
+    std::iota(vertices.begin(), vertices.end(), 0);
+    std::shuffle(vertices.begin(), vertices.end(), std::mt19937(41));
+
+    EXPECT_EQ(
+        greedyConstructor(vertices, pisa::sparseDemand::fromDense(dm)),
+        referenceGreedy(reconfigureDemandMatrix(vertices, dm))
+    );
+}
+
+TEST(GreedyTest, NoDemand_IsZero) {
+    EXPECT_EQ(greedyConstructor(0, {}), 0.0);
+    EXPECT_EQ(greedyConstructor(5, std::vector<std::vector<double>>(5, std::vector<double>(5, 0.0))), 0.0);
+}
@@ -0,0 +1,208 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <cstdint>
+#include <numeric>
+#include <random>
+
+#include <tbb/global_control.h>
+
+#include "graphbissection.hh"
+#include "onehopbissection.hh"
+#include "mloggapbissection.hh"
+
+// ── helpers ──────────────────────────────────────────────────────────────────
+
+static std::vector<std::vector<double>> randomDemand(uint32_t n, uint32_t requests, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<uint32_t> vertex(0, n - 1);
+    std::vector<std::vector<double>> demandMatrix(n, std::vector<double>(n, 0.0));
+    for (uint32_t r = 0; r < requests; ++r) {
+        uint32_t src = vertex(rng);
+        uint32_t dst = vertex(rng);
+        if (src != dst) {
+            demandMatrix[src][dst] += 1;
+            demandMatrix[dst][src] += 1;
+        }
+    }
+    return demandMatrix;
+}
+
+struct LegacyRun {
+    std::vector<uint32_t> vertices;
+    double averageCostGain;
+    double averageSwappedPairs;
+    double averageIterationCount;
+};
+
+template<typename Func>
+static LegacyRun runLegacy(Func reorderFn, const std::vector<std::vector<double>>& demandMatrix, bool parallelize) {
+    uint32_t n = demandMatrix.size();
+    LegacyRun run;
+    run.vertices.resize(n);
+    std::iota(run.vertices.begin(), run.vertices.end(), 0);
+    RunConfig config;
+    config.maxIterations = 20;
+    BisectionRunRecord record(config);
+    // more workers than cores, so sibling tasks really interleave on small machines
+    tbb::global_control workers(tbb::global_control::max_allowed_parallelism, 4);
+    reorderFn(demandMatrix, run.vertices, VectorLimits_t{0, n}, 6, parallelize, record, 20);
+    run.averageCostGain = record.averageCostGain();
+    run.averageSwappedPairs = record.averageSwappedPairs();
+    run.averageIterationCount = record.averageIterationCount();
+    return run;
+}
+
+template<typename Func>
+static void expectParallelMatchesSerial(Func reorderFn) {
+    auto demandMatrix = randomDemand(48, 400, 3);
+    auto serial = runLegacy(reorderFn, demandMatrix, false);
+    auto parallel = runLegacy(reorderFn, demandMatrix, true);
+
+    EXPECT_EQ(serial.vertices, parallel.vertices);
+    EXPECT_DOUBLE_EQ(serial.averageCostGain, parallel.averageCostGain);
+    EXPECT_DOUBLE_EQ(serial.averageSwappedPairs, parallel.averageSwappedPairs);
+    EXPECT_DOUBLE_EQ(serial.averageIterationCount, parallel.averageIterationCount);
+}
+
+static double cutDemand(
+    const std::vector<std::vector<double>>& demandMatrix, const std::vector<uint32_t>& vertices,
+    const VectorLimits_t& leftLimits, const VectorLimits_t& rightLimits
+) {
+    double cut = 0;
+    for (uint32_t l = leftLimits.leftLimit; l < leftLimits.rightLimit; ++l) {
+        for (uint32_t r = rightLimits.leftLimit; r < rightLimits.rightLimit; ++r) {
+            cut += basic::pairDemand(demandMatrix, vertices[l], vertices[r]);
+        }
+    }
+    return cut;
+}
+
+// ── basic (Kernighan-Lin) ────────────────────────────────────────────────────
+
+TEST(LegacyBisectionTest, Basic_DValuesGiveExactPairGain) {
+    auto demandMatrix = randomDemand(12, 60, 1);
+    std::vector<uint32_t> vertices(12);
+    std::iota(vertices.begin(), vertices.end(), 0);
+    VectorLimits_t left{0, 6}, right{6, 12};
+    double cut = cutDemand(demandMatrix, vertices, left, right);
+
+    for (uint32_t a = 0; a < 6; ++a) {
+        for (uint32_t b = 6; b < 12; ++b) {
+            double gain = basic::computeDValue(a, demandMatrix, vertices, left, right)
+                + basic::computeDValue(b, demandMatrix, vertices, right, left)
+                - 2 * basic::pairDemand(demandMatrix, vertices[a], vertices[b]);
+            auto swapped = vertices;
+            std::swap(swapped[a], swapped[b]);
+            EXPECT_NEAR(gain, cut - cutDemand(demandMatrix, swapped, left, right), 1e-9);
+        }
+    }
+}
+
+TEST(LegacyBisectionTest, Basic_PassAppliesProfitableSwapsOnly) {
+    auto demandMatrix = randomDemand(40, 300, 2);
+    std::vector<uint32_t> vertices(40);
+    std::iota(vertices.begin(), vertices.end(), 0);
+    VectorLimits_t left{0, 20}, right{20, 40};
+
+    double before = cutDemand(demandMatrix, vertices, left, right);
+    auto swaps = basic::kernighanLinPass(demandMatrix, vertices, left, right);
+    double after = cutDemand(demandMatrix, vertices, left, right);
+
+    ASSERT_FALSE(swaps.empty());
+    double totalGain = 0;
+    for (const auto& swap : swaps) {
+        totalGain += swap.costGain;
+    }
+    EXPECT_GT(totalGain, 0);
+    EXPECT_NEAR(before - after, totalGain, 1e-9);
+
+    // a second pass from the improved split only applies a profitable prefix, if any
+    auto again = basic::kernighanLinPass(demandMatrix, vertices, left, right);
+    double againGain = 0;
+    for (const auto& swap : again) {
+        againGain += swap.costGain;
+    }
+    if (!again.empty()) {
+        EXPECT_GT(againGain, 0);
+    }
+    EXPECT_NEAR(after - cutDemand(demandMatrix, vertices, left, right), againGain, 1e-9);
+}
+
+// ── mloggapa (sparse backend) ───────────────────────────────────────────────
+
+TEST(LegacyBisectionTest, MLogGapA_SparseGainMatchesDenseScan) {
+    const uint32_t n = 24;
+    auto demandMatrix = randomDemand(n, 120, 4);
+    std::vector<uint32_t> vertices(n);
+    std::iota(vertices.begin(), vertices.end(), 0);
+    std::shuffle(vertices.begin(), vertices.end(), std::mt19937(5));
+    VectorLimits_t left{4, 12}, right{12, 20};
+
+    mloggapa::Graph_t graph(pisa::sparseDemand::fromDense(demandMatrix));
+    std::vector<uint8_t> sides(n, mloggapa::OUTSIDE);
+    for (uint32_t idx = left.leftLimit; idx < left.rightLimit; ++idx) sides[vertices[idx]] = mloggapa::LEFT;
+    for (uint32_t idx = right.leftLimit; idx < right.rightLimit; ++idx) sides[vertices[idx]] = mloggapa::RIGHT;
+    singleInitSoAVector<mloggapa::NodeSectionInfo_t> infos(n);
+
+    // dense reference: scan every row of the matrix and both halves of the split
+    auto denseGain = [&](uint32_t vIdx, const VectorLimits_t& from, const VectorLimits_t& to) {
+        double nTo = to.rightLimit - to.leftLimit, nFrom = from.rightLimit - from.leftLimit;
+        double gain = 0;
+        for (uint32_t t = 0; t < n; ++t) {
+            if (demandMatrix[t][vertices[vIdx]] == 0) continue;
+            double sameN = 0, sameW = 0, othN = 0, othW = 0;
+            for (uint32_t idx = left.leftLimit; idx < left.rightLimit; ++idx) {
+                double w = demandMatrix[t][vertices[idx]];
+                if (vertices[idx] != t && w != 0) { sameN++; sameW += w; }
+            }
+            for (uint32_t idx = right.leftLimit; idx < right.rightLimit; ++idx) {
+                double w = demandMatrix[t][vertices[idx]];
+                if (vertices[idx] != t && w != 0) { othN++; othW += w; }
+            }
+            gain += sameW * log2(nTo / (sameN + 1)) + othW * log2(nFrom / (othN + 1))
+                - sameW * log2((nTo - 1) / (sameN + 1)) - othW * log2((nFrom + 1) / (othN + 1));
+        }
+        return gain;
+    };
+
+    for (uint32_t idx = left.leftLimit; idx < left.rightLimit; ++idx) {
+        auto gain = mloggapa::computeCostGain(idx, graph, vertices, sides, infos, left, right);
+        EXPECT_EQ(gain.vIdx, idx);
+        EXPECT_NEAR(gain.costGain, denseGain(idx, left, right), 1e-9);
+    }
+    for (uint32_t idx = right.leftLimit; idx < right.rightLimit; ++idx) {
+        auto gain = mloggapa::computeCostGain(idx, graph, vertices, sides, infos, right, left);
+        EXPECT_NEAR(gain.costGain, denseGain(idx, right, left), 1e-9);
+    }
+}
+
+TEST(LegacyBisectionTest, MLogGapA_SharedGraphMatchesDenseEntryPoint) {
+    auto demandMatrix = randomDemand(48, 400, 6);
+    auto dense = runLegacy([](const std::vector<std::vector<double>>& dm, auto&&... args) {
+        mloggapa::bipartiteGraphReordering(dm, args...);
+    }, demandMatrix, false);
+
+    auto graph = mloggapa::bipartiteGraph(pisa::sparseDemand::fromDense(demandMatrix));
+    auto shared = runLegacy([&graph](const auto&, auto&&... args) {
+        mloggapa::bipartiteGraphReordering(graph, args...);
+    }, demandMatrix, false);
+
+    EXPECT_EQ(dense.vertices, shared.vertices);
+    EXPECT_DOUBLE_EQ(dense.averageCostGain, shared.averageCostGain);
+}
+
+// ── parallel recursion ───────────────────────────────────────────────────────
+
+TEST(LegacyBisectionTest, Basic_ParallelMatchesSerial) {
+    expectParallelMatchesSerial(basic::graphReordering);
+}
+
+TEST(LegacyBisectionTest, OneHop_ParallelMatchesSerial) {
+    expectParallelMatchesSerial(onehop::graphReordering);
+}
+
+TEST(LegacyBisectionTest, MLogGapA_ParallelMatchesSerial) {
+    expectParallelMatchesSerial([](const std::vector<std::vector<double>>& demandMatrix, auto&&... args) {
+        mloggapa::bipartiteGraphReordering(demandMatrix, args...);
+    });
+}
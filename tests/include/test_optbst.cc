@@ -0,0 +1,221 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include <tbb/global_control.h>
+
+#include "treebuilders/optbst.hh"
+#include "util/treeCost.hh"
+
+// ── helpers ──────────────────────────────────────────────────────────────────
+
+static std::vector<std::vector<double>> randomDense(int n, int requests, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> vertex(0, n - 1);
+    std::vector<std::vector<double>> dm(n, std::vector<double>(n, 0.0));
+    for (int r = 0; r < requests; ++r) {
+        int src = vertex(rng);
+        int dst = vertex(rng);
+        if (src != dst) {
+            dm[src][dst] += 1 + rng() % 4;
+        }
+    }
+    return dm;
+}
+
+// The textbook O(n^3) interval DP over n x n matrices, as optimalBST used to run it.
+static double referenceOBST(const std::vector<std::vector<double>>& dm) {
+    int n = dm.size();
+    auto agg = buildAggregateDemandN4(n, dm);
+    std::vector<std::vector<double>> cost(n, std::vector<double>(n, 0.0));
+    for (int delta = 1; delta < n; ++delta) {
+        for (int l = 0; l + delta < n; ++l) {
+            int r = l + delta;
+            cost[l][r] = std::numeric_limits<double>::infinity();
+            for (int x = l; x <= r; ++x) {
+                double c = 0;
+                if (x != r) c += cost[x + 1][r] + agg[x + 1][r];
+                if (x != l) c += cost[l][x - 1] + agg[l][x - 1];
+                cost[l][r] = std::min(cost[l][r], c);
+            }
+        }
+    }
+    return cost[0][n - 1];
+}
+
+// ── interval cuts ────────────────────────────────────────────────────────────
+
+TEST(OptimalBSTTest, IntervalCut_MatchesQuarticAggregate) {
+    auto dm = randomDense(17, 120, 1);
+    IntervalCut_t cut(dm);
+    auto expected = buildAggregateDemandN4(17, dm);
+    for (int l = 0; l < 17; ++l) {
+        for (int r = l; r < 17; ++r) {
+            EXPECT_NEAR(cut(l, r), expected[l][r], 1e-9) << l << "," << r;
+        }
+    }
+    EXPECT_EQ(cut(5, 4), 0.0);
+    EXPECT_NEAR(cut(0, 16), 0.0, 1e-9);
+}
+
+TEST(OptimalBSTTest, IntervalCut_SparseReadsPositionsOfOrdering) {
+    auto dm = randomDense(20, 150, 2);
+    std::vector<uint32_t> vertices(20);
+    std::iota(vertices.begin(), vertices.end(), 0);
+    std::shuffle(vertices.begin(), vertices.end(), std::mt19937(3));
+
+    IntervalCut_t sparse(vertices, pisa::sparseDemand::fromDense(dm));
+    IntervalCut_t dense(reconfigureDemandMatrix(vertices, dm));
+    for (int l = 0; l < 20; ++l) {
+        for (int r = l; r < 20; ++r) {
+            EXPECT_NEAR(sparse(l, r), dense(l, r), 1e-9);
+        }
+    }
+}
+
+// ── DP ───────────────────────────────────────────────────────────────────────
+
+TEST(OptimalBSTTest, Exhaustive_MatchesReferenceDP) {
+    for (unsigned seed = 0; seed < 20; ++seed) {
+        int n = 2 + seed;
+        auto dm = randomDense(n, 4 * n, seed);
+        EXPECT_NEAR(optimalBST(n, dm), referenceOBST(dm), 1e-6) << "n=" << n;
+    }
+}
+
+TEST(OptimalBSTTest, Exhaustive_MatchesReferenceDPAcrossTiles) {
+    // spans several tile diagonals, with a ragged last tile
+    int n = 2 * obstTileSize + 19;
+    auto dm = randomDense(n, 6 * n, 11);
+    EXPECT_NEAR(optimalBST(n, dm), referenceOBST(dm), 1e-6);
+}
+
+TEST(OptimalBSTTest, Wavefront_IndependentOfThreadCount) {
+    int n = 3 * obstTileSize + 5;
+    IntervalCut_t cut(randomDense(n, 8 * n, 12));
+    for (auto search : {RootSearch_t::EXHAUSTIVE, RootSearch_t::KNUTH}) {
+        IntervalTable_t serial(n), parallel(n);
+        IntervalRoot_t serialRoot, parallelRoot;
+        {
+            tbb::global_control workers(tbb::global_control::max_allowed_parallelism, 1);
+            serialRoot = buildOptimalBST(cut, serial, search);
+        }
+        {
+            tbb::global_control workers(tbb::global_control::max_allowed_parallelism, 4);
+            parallelRoot = buildOptimalBST(cut, parallel, search);
+        }
+        EXPECT_EQ(parallelRoot.cost, serialRoot.cost);
+        EXPECT_EQ(parallelRoot.root, serialRoot.root);
+        EXPECT_EQ(obstPredecessors(parallel), obstPredecessors(serial));
+    }
+}
+
+TEST(OptimalBSTTest, Knuth_IsAnUpperBoundOfExhaustive) {
+    for (unsigned seed = 0; seed < 20; ++seed) {
+        int n = 3 + 2 * seed;
+        auto dm = randomDense(n, 4 * n, 100 + seed);
+        double exact = optimalBST(n, dm);
+        double knuth = optimalBST(n, dm, false, RootSearch_t::KNUTH);
+        EXPECT_GE(knuth, exact - 1e-9);
+    }
+}
+
+TEST(OptimalBSTTest, Knuth_CostIsThatOfItsTree) {
+    auto dm = randomDense(40, 300, 7);
+    IntervalCut_t cut(dm);
+    IntervalTable_t table(40);
+    double cost = buildOptimalBST(cut, table, RootSearch_t::KNUTH).cost;
+
+    // rebuild the tree from the roots and price it directly
+    std::vector<std::vector<uint32_t>> tree(40);
+    std::vector<int> pred = obstPredecessors(table);
+    for (int pos = 0; pos < 40; ++pos) {
+        if (pred[pos] >= 0) {
+            tree[pos].push_back(pred[pos]);
+            tree[pred[pos]].push_back(pos);
+        }
+    }
+    EXPECT_NEAR(cost, treeCost(tree, dm), 1e-6);
+}
+
+TEST(OptimalBSTTest, Predecessors_FormASearchTree) {
+    auto dm = randomDense(30, 200, 8);
+    IntervalCut_t cut(dm);
+    IntervalTable_t table(30);
+    buildOptimalBST(cut, table);
+    std::vector<int> pred = obstPredecessors(table);
+
+    EXPECT_EQ(std::count(pred.begin(), pred.end(), -1), 1);
+    // in-order property: pos lies left of every ancestor it reaches through a left child
+    for (int pos = 0; pos < 30; ++pos) {
+        int depth = 0;
+        for (int child = pos; pred[child] != -1; child = pred[child]) {
+            ASSERT_LT(++depth, 30);
+            if (child < pred[child]) {
+                EXPECT_LT(pos, pred[child]);
+            } else {
+                EXPECT_GT(pos, pred[child]);
+            }
+        }
+    }
+}
+
+TEST(OptimalBSTTest, SparseOrdering_MatchesReorderedDense) {
+    auto dm = randomDense(25, 200, 9);
+    std::vector<uint32_t> vertices(25);
+    std::iota(vertices.begin(), vertices.end(), 0);
+    std::shuffle(vertices.begin(), vertices.end(), std::mt19937(10));
+
+    double dense = optimalBST(25, reconfigureDemandMatrix(vertices, dm));
+    double sparse = optimalBST(vertices, pisa::sparseDemand::fromDense(dm));
+    EXPECT_NEAR(sparse, dense, 1e-6);
+}
+
+// ── emitted tree ─────────────────────────────────────────────────────────────
+
+TEST(OptimalBSTTest, TreeCost_MatchesSparseEvaluatorOfItsPredecessors) {
+    auto dm = randomDense(90, 700, 13);
+    std::vector<uint32_t> vertices(90);
+    std::iota(vertices.begin(), vertices.end(), 0);
+    std::shuffle(vertices.begin(), vertices.end(), std::mt19937(14));
+    auto demand = pisa::sparseDemand::fromDense(dm);
+
+    for (auto search : {RootSearch_t::EXHAUSTIVE, RootSearch_t::KNUTH}) {
+        ObstTree_t tree = optimalBSTTree(vertices, demand, search);
+        EXPECT_NEAR(pisa::searchTreeCost(vertices, tree.predecessors, demand), tree.cost, 1e-6);
+    }
+}
+
+TEST(OptimalBSTTest, TreeFile_RoundTrips) {
+    auto dm = randomDense(33, 200, 15);
+    std::vector<uint32_t> vertices(33);
+    std::iota(vertices.begin(), vertices.end(), 0);
+    std::shuffle(vertices.begin(), vertices.end(), std::mt19937(16));
+    ObstTree_t tree = optimalBSTTree(vertices, pisa::sparseDemand::fromDense(dm));
+
+    std::string path = (std::filesystem::temp_directory_path() / "obst_tree_test.tree").string();
+    writeObstTree(path, vertices, tree);
+    std::vector<uint32_t> readVertices;
+    ObstTree_t read = readObstTree(path, readVertices);
+    std::filesystem::remove(path);
+
+    EXPECT_EQ(readVertices, vertices);
+    EXPECT_EQ(read.predecessors, tree.predecessors);
+    EXPECT_EQ(read.cost, tree.cost);
+}
+
+TEST(OptimalBSTTest, TreeFile_RejectsMissingFile) {
+    std::vector<uint32_t> vertices;
+    EXPECT_THROW(readObstTree("/nonexistent/obst.tree", vertices), std::runtime_error);
+}
+
+TEST(OptimalBSTTest, TinyInputs) {
+    EXPECT_EQ(optimalBST(0, {}), 0.0);
+    EXPECT_EQ(optimalBST(1, {{0.0}}), 0.0);
+    EXPECT_EQ(optimalBST(2, {{0.0, 3.0}, {1.0, 0.0}}), 4.0);
+}
@@ -0,0 +1,235 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <algorithm>
+
+#include "recursiveGraphBisection.hh"
+#include "util/forwardIndexFactory.hh"
+#include "util/sparseDemand.hh"
+
+// ── helpers ──────────────────────────────────────────────────────────────────
+
+static pisa::sparseDemand randomTrace(uint32_t n, uint32_t requests, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<uint32_t> vertex(0, n - 1);
+    pisa::edgeAccumulator acc(n);
+    for (uint32_t r = 0; r < requests; ++r) {
+        acc.addUndirected(vertex(rng), vertex(rng));
+    }
+    return acc.build();
+}
+
+static std::vector<uint32_t> runBisection(
+    const pisa::forwardIndex& fwd, size_t depth, const pisa::bisectionConfig& config
+) {
+    std::vector<uint32_t> vertices(fwd.documentCount());
+    std::iota(vertices.begin(), vertices.end(), 0);
+    std::vector<double> gains(vertices.size(), 0.0);
+    pisa::verticeRange range(vertices.begin(), vertices.end(), std::cref(fwd), std::ref(gains));
+    pisa::recursiveGraphBisection(range, depth, 20, depth - 2, config);
+    return vertices;
+}
+
+// ── recursiveGraphBisection ──────────────────────────────────────────────────
+
+static void expectPermutation(std::vector<uint32_t> order) {
+    std::sort(order.begin(), order.end());
+    for (uint32_t v = 0; v < order.size(); ++v) {
+        EXPECT_EQ(order[v], v);
+    }
+}
+
+TEST(RecursiveGraphBisectionTest, OutputIsPermutation) {
+    auto fwd = pisa::createMlogaForwardIndex(randomTrace(64, 400, 1));
+    expectPermutation(runBisection(fwd, 6, {}));
+}
+
+TEST(RecursiveGraphBisectionTest, SelectionStrategies_MatchFullSort) {
+    auto demand = randomTrace(200, 1500, 6);
+    for (const auto& fwd : {pisa::createMlogaForwardIndex(demand), pisa::createLogGapForwardIndex(demand)}) {
+        auto fullSort = runBisection(fwd, 7, {});
+        expectPermutation(fullSort);
+
+        pisa::bisectionConfig candidates;
+        candidates.selection = pisa::selectionStrategy::candidatesOnly;
+        EXPECT_EQ(runBisection(fwd, 7, candidates), fullSort);
+
+        pisa::bisectionConfig parallelSort;
+        parallelSort.parallel_sort_threshold = 1;
+        EXPECT_EQ(runBisection(fwd, 7, parallelSort), fullSort);
+    }
+}
+
+TEST(RecursiveGraphBisectionTest, IncrementalGains_MatchFullRecompute) {
+    for (unsigned seed : {1u, 2u, 3u}) {
+        auto demand = randomTrace(128, 900, seed);
+        for (const auto& fwd : {pisa::createMlogaForwardIndex(demand), pisa::createLogGapForwardIndex(demand)}) {
+            pisa::bisectionConfig incremental;
+            incremental.incremental_gains = true;
+            EXPECT_EQ(runBisection(fwd, 7, {}), runBisection(fwd, 7, incremental)) << "seed " << seed;
+        }
+    }
+}
+
+TEST(RecursiveGraphBisectionTest, Record_CollectsPerLevelSamples) {
+    auto fwd = pisa::createMlogaForwardIndex(randomTrace(64, 400, 4));
+    RunConfig cfg;
+    cfg.maxIterations = 20;
+    BisectionRunRecord record(cfg);
+    pisa::bisectionConfig config;
+    config.record = &record;
+
+    runBisection(fwd, 3, config);
+
+    // 1 + 2 + 4 partitions processed, each within [1, maxIterations] passes
+    EXPECT_GE(record.averageIterationCount(), 1.0);
+    EXPECT_LE(record.averageIterationCount(), 20.0);
+    EXPECT_GT(record.averageSwappedPairs(), 0.0);
+    EXPECT_GT(record.averageCostGain(), 0.0);
+}
+
+TEST(RecursiveGraphBisectionTest, GainThreshold_StopsAfterFirstPass) {
+    auto fwd = pisa::createLogGapForwardIndex(randomTrace(96, 700, 5));
+    BisectionRunRecord record(RunConfig{});
+    pisa::bisectionConfig config;
+    config.min_pass_gain = 1e18;
+    config.record = &record;
+
+    runBisection(fwd, 4, config);
+    EXPECT_DOUBLE_EQ(record.averageIterationCount(), 1.0);
+}
+
+TEST(RecursiveGraphBisectionTest, ParallelGainPass_MatchesSerial) {
+    auto demand = randomTrace(256, 2000, 7);
+    for (const auto& fwd : {pisa::createMlogaForwardIndex(demand), pisa::createLogGapForwardIndex(demand)}) {
+        for (bool incremental : {false, true}) {
+            pisa::bisectionConfig serial;
+            serial.incremental_gains = incremental;
+            pisa::bisectionConfig parallel = serial;
+            parallel.parallel_gain_threshold = 1;
+            parallel.parallel_grain_size = 8;
+            EXPECT_EQ(runBisection(fwd, 8, serial), runBisection(fwd, 8, parallel));
+        }
+    }
+}
+
+TEST(RecursiveGraphBisectionTest, VectorisedGains_ProducePermutation) {
+    auto demand = randomTrace(256, 2000, 8);
+    for (const auto& fwd : {pisa::createMlogaForwardIndex(demand), pisa::createLogGapForwardIndex(demand)}) {
+        for (bool incremental : {false, true}) {
+            pisa::bisectionConfig config;
+            config.vectorised_gains = true;
+            config.incremental_gains = incremental;
+            expectPermutation(runBisection(fwd, 8, config));
+        }
+    }
+}
+
+TEST(RecursiveGraphBisectionTest, VectorisedGains_MatchCachedGainsPerVertex) {
+    auto demand = randomTrace(256, 2000, 12);
+    for (const auto& fwd : {pisa::createMlogaForwardIndex(demand), pisa::createLogGapForwardIndex(demand)}) {
+        // an arbitrary, uneven split, so the two log sizes differ
+        std::vector<uint32_t> vertices(fwd.documentCount());
+        std::iota(vertices.begin(), vertices.end(), 0);
+        std::shuffle(vertices.begin(), vertices.end(), std::mt19937(13));
+        std::vector<double> cached(vertices.size(), 0.0);
+        std::vector<double> vectorised(vertices.size(), 0.0);
+        auto left = pisa::verticeRange(vertices.begin(), vertices.begin() + 100, std::cref(fwd), std::ref(cached));
+        auto right = pisa::verticeRange(vertices.begin() + 100, vertices.end(), std::cref(fwd), std::ref(cached));
+        pisa::verticePartition<std::vector<uint32_t>::iterator> partition{left, right, fwd.termCount()};
+
+        degreeMap leftDegree(fwd.termCount());
+        degreeMap rightDegree(fwd.termCount());
+        pisa::computeDegrees(partition.left, leftDegree);
+        pisa::computeDegrees(partition.right, rightDegree);
+        degreeMapPair degrees{leftDegree, rightDegree};
+        uint32_t maxDegree = 1;
+        for (uint32_t t = 0; t < fwd.termCount(); ++t) {
+            maxDegree = std::max(maxDegree, leftDegree[t] + rightDegree[t]);
+        }
+
+        pisa::bp::ThreadLocal local;
+        pisa::computeGains(partition, degrees, pisa::computeMoveGainsCaching<false, std::vector<uint32_t>::iterator>, local);
+
+        for (auto isa : {pisa::bp::gainKernelIsa::scalar, pisa::bp::detectGainKernelIsa()}) {
+            pisa::bp::ThreadLocal tableLocal;
+            tableLocal.gain_table = pisa::bp::moveGainTable(maxDegree);
+            tableLocal.move_deltas = pisa::bp::moveDeltaKernel(isa);
+            auto tableLeft = pisa::verticeRange(vertices.begin(), vertices.begin() + 100, std::cref(fwd), std::ref(vectorised));
+            auto tableRight = pisa::verticeRange(vertices.begin() + 100, vertices.end(), std::cref(fwd), std::ref(vectorised));
+            pisa::verticePartition<std::vector<uint32_t>::iterator> tablePartition{tableLeft, tableRight, fwd.termCount()};
+            pisa::computeGains(tablePartition, degrees, pisa::computeMoveGainsVectorised<std::vector<uint32_t>::iterator>, tableLocal);
+
+            for (uint32_t v = 0; v < vertices.size(); ++v) {
+                EXPECT_NEAR(vectorised[v], cached[v], 1e-9 * std::max(1.0, std::abs(cached[v])))
+                    << "vertex " << v << " isa " << static_cast<int>(isa);
+            }
+        }
+    }
+}
+
+TEST(RecursiveGraphBisectionTest, PartitionTermGains_MatchCachedGains) {
+    auto demand = randomTrace(256, 2000, 9);
+    for (const auto& fwd : {pisa::createMlogaForwardIndex(demand), pisa::createLogGapForwardIndex(demand)}) {
+        for (bool incremental : {false, true}) {
+            pisa::bisectionConfig cached;
+            cached.incremental_gains = incremental;
+            pisa::bisectionConfig table = cached;
+            table.partition_term_gains = true;
+            EXPECT_EQ(runBisection(fwd, 8, cached), runBisection(fwd, 8, table));
+
+            table.vectorised_gains = true;
+            table.parallel_gain_threshold = 1;
+            table.parallel_grain_size = 8;
+            expectPermutation(runBisection(fwd, 8, table));
+        }
+    }
+}
+
+TEST(RecursiveGraphBisectionTest, LocalTermRemapping_MatchesGlobal) {
+    auto demand = randomTrace(256, 2000, 10);
+    for (const auto& fwd : {pisa::createMlogaForwardIndex(demand), pisa::createLogGapForwardIndex(demand)}) {
+        for (bool table : {false, true}) {
+            pisa::bisectionConfig global;
+            global.partition_term_gains = table;
+            global.incremental_gains = table;
+            pisa::bisectionConfig local = global;
+            local.local_term_threshold = 64;
+            EXPECT_EQ(runBisection(fwd, 8, global), runBisection(fwd, 8, local));
+        }
+    }
+}
+
+TEST(RecursiveGraphBisectionTest, ExtractSubIndex_PrunesSingletonTerms) {
+    pisa::forwardIndex fwd({{5, 1}, {1, 7}, {3}, {7, 5, 9}}, 10);
+    std::vector<uint32_t> vertices{1, 2, 3};
+    std::vector<double> gains(4, 0.0);
+    pisa::verticeRange range(vertices.begin(), vertices.end(), std::cref(fwd), std::ref(gains));
+
+    degreeMap slots(fwd.termCount());
+    degreeMap counts(fwd.termCount());
+    auto sub = pisa::extractSubIndex(range, slots, &counts, 2);
+
+    // only term 7 is held by two of {1, 2, 3}
+    EXPECT_EQ(sub.fwdidx.termCount(), 1);
+    EXPECT_EQ(sub.global_vertices, (std::vector<uint32_t>{1, 2, 3}));
+    EXPECT_EQ(sub.vertices, (std::vector<uint32_t>{0, 1, 2}));
+    EXPECT_EQ(sub.fwdidx.terms(0), (std::vector<uint32_t>{0}));
+    EXPECT_TRUE(sub.fwdidx.terms(1).empty());
+    EXPECT_EQ(sub.fwdidx.terms(2), (std::vector<uint32_t>{0}));
+}
+
+TEST(RecursiveGraphBisectionTest, ChildSubIndexes_ProducePermutation) {
+    auto demand = randomTrace(256, 2000, 11);
+    for (const auto& fwd : {pisa::createMlogaForwardIndex(demand), pisa::createLogGapForwardIndex(demand)}) {
+        for (bool table : {false, true}) {
+            pisa::bisectionConfig config;
+            config.child_subindexes = true;
+            config.partition_term_gains = table;
+            config.incremental_gains = table;
+            expectPermutation(runBisection(fwd, 8, config));
+        }
+    }
+}
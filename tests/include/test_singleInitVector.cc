@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+
+#include "util/singleInitVector.hh"
+
+// ── singleInitVector ─────────────────────────────────────────────────────────
+
+TEST(SingleInitVectorTest, ClearResetsToDefault) {
+    singleInitVector<double> vec(4);
+    vec.set(1, 2.5);
+    EXPECT_TRUE(vec.has_value(1));
+    EXPECT_DOUBLE_EQ(vec[1], 2.5);
+
+    vec.clear();
+    EXPECT_FALSE(vec.has_value(1));
+    EXPECT_DOUBLE_EQ(vec[1], 0.0);
+}
+
+// ── singleInitSoAVector ──────────────────────────────────────────────────────
+
+TEST(SingleInitSoAVectorTest, UnsetEntriesReturnDefault) {
+    singleInitSoAVector<uint32_t> vec(3);
+    EXPECT_EQ(vec.size(), 3);
+    for (std::size_t i = 0; i < 3; ++i) {
+        EXPECT_FALSE(vec.has_value(i));
+        EXPECT_EQ(vec[i], 0);
+    }
+}
+
+TEST(SingleInitSoAVectorTest, SetAndClear) {
+    singleInitSoAVector<double> vec(3);
+    vec.set(0, 1.5);
+    vec.set(2, -4.0);
+    EXPECT_DOUBLE_EQ(vec[0], 1.5);
+    EXPECT_DOUBLE_EQ(vec[2], -4.0);
+    EXPECT_FALSE(vec.has_value(1));
+
+    vec.clear();
+    EXPECT_FALSE(vec.has_value(0));
+    EXPECT_DOUBLE_EQ(vec[2], 0.0);
+
+    vec.set(2, 3.0);
+    EXPECT_DOUBLE_EQ(vec[2], 3.0);
+}
+
+TEST(SingleInitSoAVectorTest, ResizeKeepsGenerationSemantics) {
+    singleInitSoAVector<uint32_t> vec;
+    vec.resize(2);
+    vec.set(1, 7);
+    vec.resize(5);
+    EXPECT_EQ(vec[1], 7);
+    EXPECT_FALSE(vec.has_value(4));
+}
+
+TEST(SingleInitSoAVectorTest, GenerationWraparound_DoesNotResurrectStaleValues) {
+    singleInitSoAVector<uint32_t, uint8_t> vec(2);
+    vec.set(0, 42);
+    // an 8-bit generation wraps back to the stamp of entry 0 within 256 clears
+    for (int i = 0; i < 300; ++i) {
+        vec.clear();
+        EXPECT_FALSE(vec.has_value(0)) << "after clear " << i;
+    }
+    EXPECT_EQ(vec[0], 0);
+
+    vec.set(1, 9);
+    EXPECT_EQ(vec[1], 9);
+    vec.clear();
+    EXPECT_FALSE(vec.has_value(1));
+}
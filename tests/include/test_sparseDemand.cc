@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+
+#include "util/sparseDemand.hh"
+
+// ── edgeAccumulator ─────────────────────────────────────────────────────────
+
+TEST(EdgeAccumulatorTest, Empty_ProducesEmptyRows) {
+    pisa::edgeAccumulator acc(3);
+    auto demand = acc.build();
+
+    EXPECT_EQ(demand.numVertices(), 3);
+    EXPECT_EQ(demand.numEntries(), 0);
+    for (uint32_t v = 0; v < 3; ++v) {
+        EXPECT_TRUE(demand.row(v).empty());
+    }
+}
+
+TEST(EdgeAccumulatorTest, DuplicatesAreSummed) {
+    pisa::edgeAccumulator acc(2);
+    acc.add(0, 1);
+    acc.add(0, 1);
+    acc.add(0, 1, 2.5);
+    auto demand = acc.build();
+
+    EXPECT_EQ(demand.numEntries(), 1);
+    EXPECT_DOUBLE_EQ(demand.weight(0, 1), 4.5);
+    EXPECT_DOUBLE_EQ(demand.weight(1, 0), 0.0);
+}
+
+TEST(EdgeAccumulatorTest, RowsAreSortedByDestination) {
+    pisa::edgeAccumulator acc(5);
+    acc.add(2, 4);
+    acc.add(2, 0);
+    acc.add(2, 3);
+    acc.add(2, 0);
+    auto demand = acc.build();
+
+    auto row = demand.row(2);
+    ASSERT_EQ(row.size(), 3);
+    std::vector<uint32_t> dsts;
+    for (const auto& e : row) dsts.push_back(e.dst);
+    EXPECT_EQ(dsts, (std::vector<uint32_t>{0, 3, 4}));
+}
+
+TEST(EdgeAccumulatorTest, AddUndirected_IsSymmetric) {
+    pisa::edgeAccumulator acc(3);
+    acc.addUndirected(0, 2);
+    acc.addUndirected(1, 1);
+    auto demand = acc.build();
+
+    EXPECT_DOUBLE_EQ(demand.weight(0, 2), 1.0);
+    EXPECT_DOUBLE_EQ(demand.weight(2, 0), 1.0);
+    // self-loop counted from both endpoints, as the dense loader did
+    EXPECT_DOUBLE_EQ(demand.weight(1, 1), 2.0);
+}
+
+TEST(EdgeAccumulatorTest, OutOfRange_Throws) {
+    pisa::edgeAccumulator acc(2);
+    EXPECT_THROW(acc.add(0, 2), std::out_of_range);
+    EXPECT_THROW(acc.add(5, 0), std::out_of_range);
+}
+
+// ── sparseDemand ────────────────────────────────────────────────────────────
+
+TEST(SparseDemandTest, FromDense_RoundTrips) {
+    std::vector<std::vector<double>> dm = {
+        {0.0, 1.0, 0.0},
+        {2.0, 0.0, 3.0},
+        {0.0, 0.0, 4.0}
+    };
+    auto demand = pisa::sparseDemand::fromDense(dm);
+
+    EXPECT_EQ(demand.numVertices(), 3);
+    EXPECT_EQ(demand.numEntries(), 4);
+    EXPECT_EQ(demand.toDense(), dm);
+}
+
+TEST(SparseDemandTest, Weight_AbsentEntryIsZero) {
+    std::vector<std::vector<double>> dm = {
+        {0.0, 1.0},
+        {0.0, 0.0}
+    };
+    auto demand = pisa::sparseDemand::fromDense(dm);
+
+    EXPECT_DOUBLE_EQ(demand.weight(0, 1), 1.0);
+    EXPECT_DOUBLE_EQ(demand.weight(1, 0), 0.0);
+    EXPECT_DOUBLE_EQ(demand.weight(0, 0), 0.0);
+}
+
+TEST(SparseDemandTest, DefaultConstructed_IsEmpty) {
+    pisa::sparseDemand demand;
+    EXPECT_EQ(demand.numVertices(), 0);
+    EXPECT_EQ(demand.numEntries(), 0);
+}
+
+TEST(SparseDemandTest, Transposed_SwapsSourceAndDestination) {
+    std::vector<std::vector<double>> dm = {
+        {0.0, 1.0, 0.0},
+        {2.0, 0.0, 3.0},
+        {0.0, 0.0, 4.0}
+    };
+    auto transposed = pisa::sparseDemand::fromDense(dm).transposed();
+
+    EXPECT_EQ(transposed.numEntries(), 4);
+    EXPECT_EQ(transposed.toDense(), (std::vector<std::vector<double>>{
+        {0.0, 2.0, 0.0},
+        {1.0, 0.0, 0.0},
+        {0.0, 3.0, 4.0}
+    }));
+}
+
+TEST(SparseDemandTest, Symmetrised_SumsBothDirections) {
+    std::vector<std::vector<double>> dm = {
+        {1.0, 1.0, 0.0},
+        {2.0, 0.0, 3.0},
+        {0.0, 0.0, 4.0}
+    };
+    auto symmetric = pisa::sparseDemand::fromDense(dm).symmetrised();
+
+    EXPECT_EQ(symmetric.toDense(), (std::vector<std::vector<double>>{
+        {2.0, 3.0, 0.0},
+        {3.0, 0.0, 3.0},
+        {0.0, 3.0, 8.0}
+    }));
+}
+
+TEST(SparseDemandTest, Accumulator_KeepLastOverwritesAndDropsZeros) {
+    pisa::edgeAccumulator acc(3);
+    acc.add(0, 2, 1.0);
+    acc.add(1, 0, 5.0);
+    acc.add(0, 2, 7.0);
+    acc.add(1, 0, 0.0);
+    acc.add(2, 2, 3.0);
+    auto demand = acc.build(pisa::duplicateCells::keepLast);
+
+    EXPECT_EQ(demand.numEntries(), 2u);
+    EXPECT_EQ(demand.toDense(), (std::vector<std::vector<double>>{
+        {0.0, 0.0, 7.0},
+        {0.0, 0.0, 0.0},
+        {0.0, 0.0, 3.0}
+    }));
+}
@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <tbb/global_control.h>
+
+#include "util/traceParser.hh"
+
+// ── helpers ──────────────────────────────────────────────────────────────────
+
+static void expectSameDemand(const pisa::sparseDemand& a, const pisa::sparseDemand& b) {
+    ASSERT_EQ(a.numVertices(), b.numVertices());
+    ASSERT_EQ(a.numEntries(), b.numEntries());
+    for (uint32_t v = 0; v < a.numVertices(); ++v) {
+        auto ra = a.row(v);
+        auto rb = b.row(v);
+        ASSERT_EQ(ra.size(), rb.size());
+        for (std::size_t i = 0; i < ra.size(); ++i) {
+            EXPECT_EQ(ra.begin()[i].dst, rb.begin()[i].dst);
+            EXPECT_DOUBLE_EQ(ra.begin()[i].weight, rb.begin()[i].weight);
+        }
+    }
+}
+
+// ── request traces ───────────────────────────────────────────────────────────
+
+TEST(TraceParserTest, Requests_CommaSeparated) {
+    auto demand = pisa::parseDemandText("4,3\n0,1\n1,2\n0,1\n", pisa::textFormat::requests);
+
+    pisa::edgeAccumulator expected(4);
+    expected.addUndirected(0, 1);
+    expected.addUndirected(1, 2);
+    expected.addUndirected(0, 1);
+    expectSameDemand(demand, expected.build());
+}
+
+TEST(TraceParserTest, Requests_SpaceSeparatedLikeWorkloadOutput) {
+    auto comma = pisa::parseDemandText("4,2\n0,3\n2,1", pisa::textFormat::requests);
+    auto space = pisa::parseDemandText("4 2\r\n0 3\r\n2 1\r\n", pisa::textFormat::requests);
+    expectSameDemand(space, comma);
+}
+
+TEST(TraceParserTest, Requests_OnlyHeaderCountIsUsed) {
+    auto demand = pisa::parseDemandText("3,1\n0,1\n1,2\n", pisa::textFormat::requests);
+    EXPECT_EQ(demand.numEntries(), 2u);
+    EXPECT_DOUBLE_EQ(demand.weight(1, 2), 0.0);
+}
+
+TEST(TraceParserTest, Requests_LinesAfterTheLastRequestAreNotRead) {
+    auto demand = pisa::parseDemandText("3,2\n0,1\n1,2\nnot a request\n7,9\n", pisa::textFormat::requests);
+    auto expected = pisa::parseDemandText("3,2\n0,1\n1,2\n", pisa::textFormat::requests);
+    expectSameDemand(demand, expected);
+}
+
+TEST(TraceParserTest, Requests_BlankLineCountsTowardTheRequests) {
+    auto demand = pisa::parseDemandText("3,2\n0,1\n\n1,2\n", pisa::textFormat::requests);
+    EXPECT_EQ(demand.numEntries(), 2u);
+    EXPECT_DOUBLE_EQ(demand.weight(1, 2), 0.0);
+}
+
+TEST(TraceParserTest, Requests_TooFewLinesThrows) {
+    EXPECT_THROW(pisa::parseDemandText("3,2\n0,1\n", pisa::textFormat::requests), std::runtime_error);
+}
+
+TEST(TraceParserTest, Requests_OutOfRangeVertexThrows) {
+    EXPECT_THROW(pisa::parseDemandText("3,1\n0,3\n", pisa::textFormat::requests), std::runtime_error);
+}
+
+TEST(TraceParserTest, Requests_MalformedFieldThrows) {
+    EXPECT_THROW(pisa::parseDemandText("3,1\n0,x\n", pisa::textFormat::requests), std::runtime_error);
+    EXPECT_THROW(pisa::parseDemandText("3,1\n-1,2\n", pisa::textFormat::requests), std::runtime_error);
+    EXPECT_THROW(pisa::parseDemandText("", pisa::textFormat::requests), std::runtime_error);
+}
+
+TEST(TraceParserTest, Requests_ParallelChunksMatchSerial) {
+    tbb::global_control workers(tbb::global_control::max_allowed_parallelism, 4);
+    // large enough to be cut into several chunks
+    const uint32_t n = 5000;
+    const uint32_t requests = 1200000;
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<uint32_t> vertex(0, n - 1);
+    std::string text = std::to_string(n) + "," + std::to_string(requests) + "\n";
+    for (uint32_t r = 0; r < requests; ++r) {
+        text += std::to_string(vertex(rng)) + "," + std::to_string(vertex(rng)) + "\n";
+    }
+    ASSERT_GT(text.size(), 2 * pisa::textParse::chunkBytes);
+
+    auto serial = pisa::parseDemandText(text, pisa::textFormat::requests, false);
+    auto parallel = pisa::parseDemandText(text, pisa::textFormat::requests, true);
+    expectSameDemand(parallel, serial);
+}
+
+// ── weight files ─────────────────────────────────────────────────────────────
+
+TEST(TraceParserTest, Weights_MatchDenseAssignment) {
+    std::string text = "3\n0 1 2.5\n2 0 1\n0 1 4\n1 2 0\n1 1 0.125\n";
+    auto demand = pisa::parseDemandText(text, pisa::textFormat::weights);
+
+    // what bin/main used to build: assign every line into a dense matrix
+    std::vector<std::vector<double>> dense(3, std::vector<double>(3, 0.0));
+    dense[0][1] = 2.5;
+    dense[2][0] = 1;
+    dense[0][1] = 4;
+    dense[1][2] = 0;
+    dense[1][1] = 0.125;
+    expectSameDemand(demand, pisa::sparseDemand::fromDense(dense));
+}
+
+TEST(TraceParserTest, Weights_CommaSeparated) {
+    auto space = pisa::parseDemandText("2\n0 1 3\n", pisa::textFormat::weights);
+    auto comma = pisa::parseDemandText("2\n0,1,3\n", pisa::textFormat::weights);
+    expectSameDemand(comma, space);
+}
+
+TEST(TraceParserTest, Weights_MissingFlowThrows) {
+    EXPECT_THROW(pisa::parseDemandText("2\n0 1\n", pisa::textFormat::weights), std::runtime_error);
+}
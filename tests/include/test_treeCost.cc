@@ -0,0 +1,183 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <algorithm>
+
+#include "core/util.hh"
+#include "util/sparseDemand.hh"
+#include "util/treeCost.hh"
+
+// ── helpers ──────────────────────────────────────────────────────────────────
+
+static double denseBalancedTreeCost(
+    const std::vector<uint32_t>& ordering, const std::vector<std::vector<double>>& dm
+) {
+    uint32_t n = ordering.size();
+    std::vector<std::vector<uint32_t>> tree(n, std::vector<uint32_t>());
+    buildBalancedBinaryTree(ordering, tree, {0, n}, -1);
+    return treeCost(tree, dm);
+}
+
+static std::vector<std::vector<double>> randomDemand(uint32_t n, double density, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    std::uniform_int_distribution<int> weight(1, 9);
+    std::vector<std::vector<double>> dm(n, std::vector<double>(n, 0.0));
+    for (uint32_t i = 0; i < n; ++i) {
+        for (uint32_t j = 0; j < n; ++j) {
+            if (coin(rng) < density) dm[i][j] = weight(rng);
+        }
+    }
+    return dm;
+}
+
+// ── balancedTreeDistance ────────────────────────────────────────────────────
+
+TEST(BalancedTreeDistanceTest, RootHasDepthZero) {
+    pisa::balancedTreeDistance tree(7);
+    EXPECT_EQ(tree.depth(3), 0);
+    EXPECT_EQ(tree.depth(1), 1);
+    EXPECT_EQ(tree.depth(5), 1);
+    EXPECT_EQ(tree.depth(0), 2);
+    EXPECT_EQ(tree.depth(6), 2);
+}
+
+TEST(BalancedTreeDistanceTest, DistanceIsSymmetricAndZeroOnDiagonal) {
+    pisa::balancedTreeDistance tree(10);
+    for (uint32_t a = 0; a < 10; ++a) {
+        EXPECT_EQ(tree.distance(a, a), 0);
+        for (uint32_t b = 0; b < 10; ++b) {
+            EXPECT_EQ(tree.distance(a, b), tree.distance(b, a));
+        }
+    }
+}
+
+TEST(BalancedTreeDistanceTest, MatchesBfsDistances) {
+    for (uint32_t n : {1u, 2u, 5u, 16u, 33u}) {
+        std::vector<uint32_t> order(n);
+        std::iota(order.begin(), order.end(), 0);
+        std::vector<std::vector<uint32_t>> adj(n, std::vector<uint32_t>());
+        buildBalancedBinaryTree(order, adj, {0, n}, -1);
+        std::vector<std::vector<uint32_t>> dist(n, std::vector<uint32_t>(n, INF));
+        computeDistances(n, adj, dist);
+
+        pisa::balancedTreeDistance tree(n);
+        for (uint32_t a = 0; a < n; ++a) {
+            for (uint32_t b = 0; b < n; ++b) {
+                EXPECT_EQ(tree.distance(a, b), dist[a][b]) << "n=" << n << " a=" << a << " b=" << b;
+            }
+        }
+    }
+}
+
+// ── balancedTreeCost ────────────────────────────────────────────────────────
+
+TEST(BalancedTreeCostTest, IdentityOrdering_MatchesDense) {
+    auto dm = randomDemand(40, 0.1, 7);
+    std::vector<uint32_t> order(40);
+    std::iota(order.begin(), order.end(), 0);
+
+    EXPECT_DOUBLE_EQ(
+        pisa::balancedTreeCost(order, pisa::sparseDemand::fromDense(dm)),
+        denseBalancedTreeCost(order, dm)
+    );
+}
+
+TEST(BalancedTreeCostTest, ShuffledOrdering_MatchesReconfiguredDense) {
+    auto dm = randomDemand(64, 0.05, 11);
+    std::vector<uint32_t> order(64);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), std::mt19937(3));
+
+    std::vector<uint32_t> canonical(64);
+    std::iota(canonical.begin(), canonical.end(), 0);
+    double expected = denseBalancedTreeCost(canonical, reconfigureDemandMatrix(order, dm));
+
+    EXPECT_DOUBLE_EQ(pisa::balancedTreeCost(order, pisa::sparseDemand::fromDense(dm)), expected);
+}
+
+TEST(BalancedTreeCostTest, EmptyDemand_IsZero) {
+    pisa::edgeAccumulator acc(8);
+    std::vector<uint32_t> order(8);
+    std::iota(order.begin(), order.end(), 0);
+    EXPECT_DOUBLE_EQ(pisa::balancedTreeCost(order, acc.build()), 0.0);
+}
+
+// ── searchTreeDistance ──────────────────────────────────────────────────────
+
+// parent position of every position of a BST over [l, r) with random roots
+static void randomSearchTree(std::vector<int>& pred, uint32_t l, uint32_t r, int parent, std::mt19937& rng) {
+    if (l >= r) return;
+    uint32_t root = l + rng() % (r - l);
+    pred[root] = parent;
+    randomSearchTree(pred, l, root, root, rng);
+    randomSearchTree(pred, root + 1, r, root, rng);
+}
+
+TEST(SearchTreeDistanceTest, MatchesBfsDistances) {
+    std::mt19937 rng(5);
+    for (uint32_t n : {1u, 2u, 7u, 30u, 65u}) {
+        std::vector<int> pred(n);
+        randomSearchTree(pred, 0, n, -1, rng);
+        std::vector<std::vector<uint32_t>> adj(n);
+        for (uint32_t pos = 0; pos < n; ++pos) {
+            if (pred[pos] != -1) {
+                adj[pos].push_back(pred[pos]);
+                adj[pred[pos]].push_back(pos);
+            }
+        }
+        std::vector<std::vector<uint32_t>> dist(n, std::vector<uint32_t>(n, INF));
+        computeDistances(n, adj, dist);
+
+        pisa::searchTreeDistance tree(pred);
+        for (uint32_t a = 0; a < n; ++a) {
+            for (uint32_t b = 0; b < n; ++b) {
+                EXPECT_EQ(tree.distance(a, b), dist[a][b]) << "n=" << n << " a=" << a << " b=" << b;
+            }
+        }
+    }
+}
+
+TEST(SearchTreeDistanceTest, BalancedPredecessors_MatchBalancedTree) {
+    const uint32_t n = 50;
+    std::vector<int> pred(n);
+    auto fill = [&](auto&& self, uint32_t l, uint32_t r, int parent) -> void {
+        if (l >= r) return;
+        uint32_t m = (l + r) / 2;
+        pred[m] = parent;
+        self(self, l, m, m);
+        self(self, m + 1, r, m);
+    };
+    fill(fill, 0, n, -1);
+
+    pisa::searchTreeDistance search(pred);
+    pisa::balancedTreeDistance balanced(n);
+    for (uint32_t a = 0; a < n; ++a) {
+        EXPECT_EQ(search.depth(a), balanced.depth(a));
+        for (uint32_t b = 0; b < n; ++b) {
+            EXPECT_EQ(search.lca(a, b), balanced.lca(a, b));
+        }
+    }
+}
+
+TEST(SearchTreeCostTest, ShuffledOrdering_MatchesDense) {
+    auto dm = randomDemand(48, 0.08, 13);
+    std::vector<uint32_t> order(48);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), std::mt19937(4));
+    std::mt19937 rng(6);
+    std::vector<int> pred(48);
+    randomSearchTree(pred, 0, 48, -1, rng);
+
+    // the same tree over vertices: position pos holds order[pos]
+    std::vector<std::vector<uint32_t>> adj(48);
+    for (uint32_t pos = 0; pos < 48; ++pos) {
+        if (pred[pos] != -1) {
+            adj[order[pos]].push_back(order[pred[pos]]);
+            adj[order[pred[pos]]].push_back(order[pos]);
+        }
+    }
+    EXPECT_DOUBLE_EQ(pisa::searchTreeCost(order, pred, pisa::sparseDemand::fromDense(dm)), treeCost(adj, dm));
+}